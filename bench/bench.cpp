@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "gpu.h"
+#include "idisplay.h"
+#include "interruptstate.h"
+#include "mmu.h"
+#include "romonly.h"
+#include "timedbus.h"
+#include "scheduler.h"
+
+#include "microbench.h"
+
+class NullDisplay : public IDisplay {
+	public:
+		virtual void render(PixelArray&) override {}
+};
+
+template <typename Bus>
+class BenchCPU : public BasicCPU<Bus> {
+	public:
+		using BasicCPU<Bus>::BasicCPU;
+
+		WORD pc() const {
+			return this->m_state.pc;
+		}
+
+		void jump(WORD pc_) {
+			this->m_state.pc = pc_;
+		}
+};
+
+// Smallest cartridge that passes the boot ROM's logo and header checksum tests.
+static std::vector<BYTE> bootableRom() {
+	static const std::array<BYTE, 48> logo{{
+		0xce, 0xed, 0x66, 0x66, 0xcc, 0x0d, 0x00, 0x0b, 0x03, 0x73, 0x00, 0x83,
+		0x00, 0x0c, 0x00, 0x0d, 0x00, 0x08, 0x11, 0x1f, 0x88, 0x89, 0x00, 0x0e,
+		0xdc, 0xcc, 0x6e, 0xe6, 0xdd, 0xdd, 0xd9, 0x99, 0xbb, 0xbb, 0x67, 0x63,
+		0x6e, 0x0e, 0xec, 0xcc, 0xdd, 0xdc, 0x99, 0x9f, 0xbb, 0xb9, 0x33, 0x3e,
+	}};
+	std::vector<BYTE> rom(0x8000, 0);
+	// 0x0100: JR -2
+	rom[0x100] = 0x18;
+	rom[0x101] = 0xfe;
+	std::copy(logo.begin(), logo.end(), rom.begin() + 0x104);
+	// header checksum: 0x19 + sum(0x134..0x14d) must be 0
+	rom[0x14d] = 0xe7;
+	return rom;
+}
+
+// Endless loop of 8-bit ALU instructions at 0x0150, about half of them followed by one that reads the flags.
+static std::vector<BYTE> aluRom() {
+	static const std::array<BYTE, 20> loop{{
+		0x06, 0x00,	// 0x0150: LD B, 0
+		0x81,		// 0x0152: ADD A, C
+		0xaa,		// XOR D
+		0x93,		// SUB E
+		0x0c,		// INC C
+		0xa4,		// AND H
+		0xb5,		// OR L
+		0x88,		// ADC A, B
+		0x14,		// INC D
+		0xb8,		// CP B
+		0x9b,		// SBC A, E
+		0x1d,		// DEC E
+		0xc6, 0x11,	// ADD A, 0x11
+		0x05,		// DEC B
+		0x20, 0xf0,	// JR NZ, 0x0152
+		0x18, 0xec,	// JR 0x0150
+	}};
+	std::vector<BYTE> rom(0x8000, 0);
+	std::copy(loop.begin(), loop.end(), rom.begin() + 0x150);
+	return rom;
+}
+
+// Endless loop of CB-prefixed rotates, shifts and bit operations at 0x0150, on registers and (HL).
+static std::vector<BYTE> bitRom() {
+	static const std::array<BYTE, 30> loop{{
+		0x21, 0x00, 0xc0,	// 0x0150: LD HL, 0xc000
+		0x06, 0x00,	// 0x0153: LD B, 0
+		0xcb, 0x01,	// 0x0155: RLC C
+		0xcb, 0x3a,	// SRL D
+		0xcb, 0x33,	// SWAP E
+		0xcb, 0x59,	// BIT 3, C
+		0xcb, 0xce,	// SET 1, (HL)
+		0xcb, 0x8e,	// RES 1, (HL)
+		0xcb, 0x16,	// RL (HL)
+		0xcb, 0x7e,	// BIT 7, (HL)
+		0xcb, 0x27,	// SLA A
+		0xcb, 0x1b,	// RR E
+		0x05,		// DEC B
+		0x20, 0xe9,	// JR NZ, 0x0155
+		0x18, 0xe5,	// JR 0x0153
+	}};
+	std::vector<BYTE> rom(0x8000, 0);
+	std::copy(loop.begin(), loop.end(), rom.begin() + 0x150);
+	return rom;
+}
+
+// Waits for VBlank by polling LY, the boot ROM unmaps itself first.
+static std::vector<BYTE> pollingRom() {
+	static const std::array<BYTE, 18> loop{{
+		0x3e, 0x01,	// 0x0150: LD A, 1
+		0xe0, 0x50,	// LDH (0x50), A
+		0xf0, 0x44,	// 0x0154: LDH A, (0x44)
+		0xfe, 0x90,	// CP 0x90
+		0x20, 0xfa,	// JR NZ, 0x0154
+		0xf0, 0x44,	// 0x015a: LDH A, (0x44)
+		0xfe, 0x90,	// CP 0x90
+		0x28, 0xfa,	// JR Z, 0x015a
+		0x18, 0xf2,	// JR 0x0154
+	}};
+	std::vector<BYTE> rom(0x8000, 0);
+	std::copy(loop.begin(), loop.end(), rom.begin() + 0x150);
+	return rom;
+}
+
+// Waits for VBlank with HALT, the interrupt handler only returns.
+static std::vector<BYTE> haltRom() {
+	static const std::array<BYTE, 10> loop{{
+		0x3e, 0x01,	// 0x0150: LD A, 1
+		0xe0, 0x50,	// LDH (0x50), A
+		0xe0, 0xff,	// LDH (0xff), A
+		0xfb,		// EI
+		0x76,		// 0x0157: HALT
+		0x18, 0xfd,	// JR 0x0157
+	}};
+	std::vector<BYTE> rom(0x8000, 0);
+	// 0x0040: RETI
+	rom[0x40] = 0xd9;
+	std::copy(loop.begin(), loop.end(), rom.begin() + 0x150);
+	return rom;
+}
+
+struct Result {
+	unsigned long long instructions = 0;
+	unsigned long long cycles = 0;
+	double seconds = 0;
+};
+
+struct Mode {
+	const char* name;
+	CPU::Engine engine;
+	// 0: step() one instruction at a time, otherwise run() batches of this many cycles
+	DWORD batch;
+	bool lazyFlags;
+	bool idleSkipping;
+	bool superinstructions;
+	// run on CPU (virtual memory accesses) instead of BasicCPU<MMU>
+	bool virtualBus;
+	// through TimedBus, see Emulator::setCycleAccurate(), needs virtualBus and batch 0
+	bool cycleAccurate;
+	// frames are run by a Scheduler, see Emulator::setScheduled(), needs a batch
+	bool scheduled;
+};
+
+static const std::array<Mode, 15> modes{{
+	{ "table", CPU::Engine::Table, 0, false, false, true, false, false, false },
+	{ "switch", CPU::Engine::Switch, 0, false, false, true, false, false, false },
+	{ "switch-virtual", CPU::Engine::Switch, 0, false, false, true, true, false, false },
+	{ "switch-mcycle", CPU::Engine::Switch, 0, false, false, true, true, true, false },
+	{ "switch+lazy", CPU::Engine::Switch, 0, true, false, true, false, false, false },
+	{ "switch/80", CPU::Engine::Switch, 80, false, false, true, false, false, false },
+	{ "threaded/80", CPU::Engine::Threaded, 80, false, false, true, false, false, false },
+	{ "threaded/80-virtual", CPU::Engine::Threaded, 80, false, false, true, true, false, false },
+	{ "threaded/sched", CPU::Engine::Threaded, 80, false, false, true, false, false, true },
+	{ "threaded/80+idle", CPU::Engine::Threaded, 80, false, true, true, false, false, false },
+	{ "cached/80-super", CPU::Engine::Cached, 80, false, false, false, false, false, false },
+	{ "cached/80", CPU::Engine::Cached, 80, false, false, true, false, false, false },
+	{ "cached/sched", CPU::Engine::Cached, 80, false, false, true, false, false, true },
+	{ "cached/80+lazy", CPU::Engine::Cached, 80, true, false, true, false, false, false },
+	{ "jit/80", CPU::Engine::Jit, 80, false, false, true, false, false, false },
+}};
+
+// The bus the CPU runs on: BasicCPU<MMU> always uses the MMU.
+template <typename Bus>
+static Bus& busFor(const Mode&, MMU& mmu, TimedBus&) {
+	return mmu;
+}
+
+template <>
+IMMU& busFor<IMMU>(const Mode& mode, MMU& mmu, TimedBus& timed) {
+	return mode.cycleAccurate ? static_cast<IMMU&>(timed) : mmu;
+}
+
+// Ticks the GPU for an instruction's cycles, or the part of them the bus hasn't ticked it for.
+static DWORD advance(const Mode& mode, GPU& gpu, TimedBus& timed, DWORD cycles) {
+	if (mode.cycleAccurate) {
+		return timed.complete(cycles);
+	}
+	gpu.step(cycles);
+	return cycles;
+}
+
+// Runs the boot ROM from reset until it hands over to the cartridge at 0x0100.
+template <typename Bus>
+static Result runBootRom(const Mode& mode) {
+	InterruptState intState{};
+	NullDisplay display{};
+	GPU gpu{display, intState};
+	MMU mmu{std::make_unique<RomOnly>(bootableRom()), gpu, intState};
+	TimedBus timed{mmu, gpu};
+	BenchCPU<Bus> cpu{busFor<Bus>(mode, mmu, timed), intState, mode.engine};
+	cpu.setLazyFlags(mode.lazyFlags);
+	cpu.setIdleSkipping(mode.idleSkipping);
+	cpu.setSuperinstructions(mode.superinstructions);
+
+	Result result{};
+	auto start = std::chrono::steady_clock::now();
+	if (mode.batch == 0) {
+		while (cpu.pc() != 0x0100) {
+			cpu.handleInterrupts();
+			DWORD cycles = advance(mode, gpu, timed, cpu.step());
+			result.instructions++;
+			result.cycles += cycles;
+		}
+	} else {
+		// the cartridge spins at 0x0100, so a batch cannot run past it
+		while (cpu.pc() != 0x0100) {
+			DWORD cycles = cpu.run(mode.batch);
+			gpu.step(cycles);
+			result.cycles += cycles;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+	return result;
+}
+
+// Runs a ROM starting at 0x0150 for a fixed number of cycles.
+template <typename Bus>
+static Result runLoop(const Mode& mode, std::vector<BYTE>&& rom) {
+	const unsigned long long cycles = 20000000;
+
+	InterruptState intState{};
+	NullDisplay display{};
+	GPU gpu{display, intState};
+	MMU mmu{std::make_unique<RomOnly>(std::move(rom)), gpu, intState};
+	TimedBus timed{mmu, gpu};
+	BenchCPU<Bus> cpu{busFor<Bus>(mode, mmu, timed), intState, mode.engine};
+	cpu.setLazyFlags(mode.lazyFlags);
+	cpu.setIdleSkipping(mode.idleSkipping);
+	cpu.setSuperinstructions(mode.superinstructions);
+	cpu.jump(0x0150);
+
+	Result result{};
+	auto start = std::chrono::steady_clock::now();
+	while (result.cycles < cycles) {
+		if (mode.batch == 0) {
+			result.cycles += advance(mode, gpu, timed, cpu.step());
+			result.instructions++;
+		} else {
+			DWORD c = cpu.run(mode.batch);
+			gpu.step(c);
+			result.cycles += c;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+	return result;
+}
+
+// Runs a ROM starting at 0x0150 for 600 frames. Batched modes run up to the next GPU event
+// like Emulator does, so a halted CPU skips straight to it. Scheduled modes do the same through
+// the tasks, the other workloads run them batched.
+template <typename Bus>
+static Result runFrames(const Mode& mode, std::vector<BYTE>&& rom) {
+	const DWORD frames = 600;
+
+	InterruptState intState{};
+	NullDisplay display{};
+	GPU gpu{display, intState};
+	MMU mmu{std::make_unique<RomOnly>(std::move(rom)), gpu, intState};
+	TimedBus timed{mmu, gpu};
+	BenchCPU<Bus> cpu{busFor<Bus>(mode, mmu, timed), intState, mode.engine};
+	cpu.setLazyFlags(mode.lazyFlags);
+	cpu.setIdleSkipping(mode.idleSkipping);
+	cpu.setSuperinstructions(mode.superinstructions);
+	cpu.jump(0x0150);
+
+	Scheduler scheduler{};
+	GpuTask gpuTask{gpu};
+	CpuTask<BenchCPU<Bus>> cpuTask{cpu};
+	scheduler.add(gpuTask);
+	scheduler.add(cpuTask);
+	gpuTask.setTime(gpu.cyclesUntilEvent());
+
+	Result result{};
+	auto start = std::chrono::steady_clock::now();
+	while (gpu.frames() < frames) {
+		if (mode.scheduled) {
+			scheduler.resumeNext(UINT64_MAX);
+		} else if (mode.batch == 0) {
+			cpu.handleInterrupts();
+			if (mode.cycleAccurate) {
+				// the dispatch's stack writes
+				result.cycles += timed.complete(0);
+			}
+			result.cycles += advance(mode, gpu, timed, cpu.step());
+			result.instructions++;
+		} else {
+			DWORD c = cpu.run(gpu.cyclesUntilEvent());
+			gpu.step(c);
+			result.cycles += c;
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	if (mode.scheduled) {
+		result.cycles = cpuTask.time();
+	}
+	result.seconds = std::chrono::duration<double>(end - start).count();
+	return result;
+}
+
+template <typename Bus>
+static Result runAluLoop(const Mode& mode) {
+	return runLoop<Bus>(mode, aluRom());
+}
+
+template <typename Bus>
+static Result runBitLoop(const Mode& mode) {
+	return runLoop<Bus>(mode, bitRom());
+}
+
+template <typename Bus>
+static Result runPolling(const Mode& mode) {
+	return runFrames<Bus>(mode, pollingRom());
+}
+
+template <typename Bus>
+static Result runHalt(const Mode& mode) {
+	return runFrames<Bus>(mode, haltRom());
+}
+
+struct Workload {
+	const char* name;
+	Result (*run)(const Mode&);
+	Result (*runVirtual)(const Mode&);
+};
+
+static void report(const Workload& workload, const Mode& mode, int runs) {
+	Result best{};
+	for (int i = 0; i < runs; i++) {
+		Result r = mode.virtualBus ? workload.runVirtual(mode) : workload.run(mode);
+		if (i == 0 || r.seconds < best.seconds) {
+			best = r;
+		}
+	}
+	std::cout << std::left << std::setw(16) << mode.name << std::right << std::fixed;
+	if (best.instructions != 0) {
+		std::cout << std::setw(10) << best.instructions << " instructions "
+			<< std::setprecision(2) << std::setw(8) << static_cast<double>(best.instructions) / best.seconds / 1e6 << " Minstr/s ";
+	} else {
+		std::cout << std::setw(45) << ' ';
+	}
+	std::cout << std::setprecision(3) << std::setw(8) << best.seconds * 1000 << " ms "
+		<< std::setprecision(2) << std::setw(8) << static_cast<double>(best.cycles) / best.seconds / 1e6 << " MHz\n";
+}
+
+// usage: bench [mode], e.g. `perf stat -e branch-misses build/bench threaded/80`
+//        bench --opcodes > opcodes.csv, see benchOpcodes()
+int main(int argc, char* argv[]) {
+	if (argc > 1 && std::string{argv[1]} == "--opcodes") {
+		benchOpcodes(std::cout);
+		return 0;
+	}
+
+	const int runs = 5;
+	const std::array<Workload, 5> workloads{{
+		{ "boot ROM", runBootRom<MMU>, runBootRom<IMMU> },
+		{ "ALU loop", runAluLoop<MMU>, runAluLoop<IMMU> },
+		{ "CB loop", runBitLoop<MMU>, runBitLoop<IMMU> },
+		{ "VBlank by polling LY, 600 frames", runPolling<MMU>, runPolling<IMMU> },
+		{ "VBlank by HALT, 600 frames", runHalt<MMU>, runHalt<IMMU> },
+	}};
+	for (const auto& workload : workloads) {
+		std::cout << workload.name << ", best of " << runs << " runs\n";
+		for (const auto& mode : modes) {
+			if (argc < 2 || std::string{argv[1]} == mode.name) {
+				report(workload, mode, runs);
+			}
+		}
+	}
+}
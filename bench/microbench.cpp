@@ -0,0 +1,181 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpuimpl.h"
+#include "interruptstate.h"
+#include "opcodes.h"
+
+#include "microbench.h"
+
+namespace {
+
+// 64 KiB of RAM, nothing mapped
+class ArrayBus final : public IMMU {
+	public:
+		BYTE readByte(WORD addr) override {
+			return m_data[addr];
+		}
+		void writeByte(WORD addr, BYTE v) override {
+			m_data[addr] = v;
+		}
+	private:
+		std::array<BYTE, 0x10000> m_data{};
+};
+
+const WORD CODE = 0x0100;
+const WORD STACK = 0xe000;
+// instructions between two restores of the registers
+const std::size_t BLOCK = 64;
+
+class MicroCPU : public BasicCPU<ArrayBus> {
+	public:
+		using BasicCPU<ArrayBus>::BasicCPU;
+
+		// whether the base opcode is implemented, every CB opcode is
+		bool implemented(BYTE opcode) const {
+			return m_instructions[opcode].opcode == opcode;
+		}
+};
+
+// 0x000-0x0ff: base opcodes, 0x100-0x1ff: CB opcodes
+using Op = unsigned;
+
+const OpcodeInfo& info(Op op) {
+	return op < 0x100 ? OPCODES[op] : CB_OPCODES[op & 0xff];
+}
+
+// Writes BLOCK instructions from the ops (repeated) at CODE, straight-line whatever they do:
+// jumps and calls go to the next instruction, returns find it on the stack and every RST vector
+// holds a RET. Operands that are addresses point into work RAM.
+CPUState assemble(ArrayBus& bus, const std::vector<Op>& ops) {
+	CPUState state{};
+	state.af = 0x1200;
+	state.bc = 0xc010;
+	state.de = 0xc020;
+	state.hl = 0xc800;
+	state.sp = STACK;
+	state.pc = CODE;
+
+	for (WORD vector = 0x00; vector <= 0x38; vector = static_cast<WORD>(vector + 8)) {
+		bus.writeByte(vector, 0xc9);
+	}
+	WORD addr = CODE;
+	WORD stack = STACK;
+	for (std::size_t i = 0; i < BLOCK; i++) {
+		Op op = ops[i % ops.size()];
+		const auto& opInfo = info(op);
+		WORD next = static_cast<WORD>(addr + opInfo.length);
+		if (op >= 0x100) {
+			bus.writeByte(addr, 0xcb);
+			bus.writeByte(static_cast<WORD>(addr + 1), static_cast<BYTE>(op));
+		} else {
+			bus.writeByte(addr, static_cast<BYTE>(op));
+			if (opInfo.length == 2) {
+				// JR to the next instruction
+				bus.writeByte(static_cast<WORD>(addr + 1), opInfo.flow == Flow::JUMP ? 0x00 : 0xc0);
+			} else if (opInfo.length == 3) {
+				bus.writeWord(static_cast<WORD>(addr + 1), opInfo.flow == Flow::NONE ? 0xc0c0 : next);
+			}
+		}
+		if (op == 0xe9) {
+			// JP HL jumps to itself
+			state.hl = CODE;
+			next = CODE;
+		}
+		if (opInfo.flow == Flow::RETURN) {
+			bus.writeWord(stack, next);
+			stack = static_cast<WORD>(stack + 2);
+		}
+		addr = next;
+	}
+	return state;
+}
+
+struct Timing {
+	double ns = 0;
+	double stddev = 0;
+	double cyclesPerInstruction = 0;
+	double mhz = 0;
+};
+
+Timing time(const std::vector<Op>& ops) {
+	const int runs = 5;
+	const std::size_t blocks = 4000;
+
+	auto bus = std::make_unique<ArrayBus>();
+	InterruptState intState{};
+	MicroCPU cpu{*bus, intState, CPU::Engine::Switch};
+	const CPUState start = assemble(*bus, ops);
+
+	std::array<double, runs> ns{};
+	double seconds = 0;
+	unsigned long long cycles = 0;
+	for (auto& run : ns) {
+		auto begin = std::chrono::steady_clock::now();
+		for (std::size_t block = 0; block < blocks; block++) {
+			cpu.restore(start);
+			for (std::size_t i = 0; i < BLOCK; i++) {
+				cycles += cpu.step();
+			}
+		}
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		seconds += elapsed;
+		run = elapsed * 1e9 / (blocks * BLOCK);
+	}
+
+	Timing timing{};
+	for (double run : ns) {
+		timing.ns += run / runs;
+	}
+	for (double run : ns) {
+		timing.stddev += (run - timing.ns) * (run - timing.ns) / runs;
+	}
+	timing.stddev = std::sqrt(timing.stddev);
+	timing.cyclesPerInstruction = static_cast<double>(cycles) / (runs * blocks * BLOCK);
+	timing.mhz = static_cast<double>(cycles) / seconds / 1e6;
+	return timing;
+}
+
+void write(std::ostream& out, const std::string& opcode, const std::string& name, const Timing& timing) {
+	out << opcode << ",\"" << name << "\"," << std::fixed
+		<< std::setprecision(3) << timing.ns << ',' << timing.stddev << ','
+		<< std::setprecision(2) << timing.cyclesPerInstruction << ',' << timing.mhz << '\n';
+}
+
+}
+
+void benchOpcodes(std::ostream& out) {
+	auto bus = std::make_unique<ArrayBus>();
+	InterruptState intState{};
+	const MicroCPU probe{*bus, intState, CPU::Engine::Table};
+
+	out << "opcode,name,ns_per_instruction,stddev_ns,cycles_per_instruction,emulated_mhz\n";
+	for (Op op = 0; op < 0x200; op++) {
+		// HALT would stop the block. RST n is timed together with the RET at its vector.
+		if (op == 0x76 || op == 0xcb || (op < 0x100 && !probe.implemented(static_cast<BYTE>(op)))) {
+			continue;
+		}
+		std::ostringstream opcode;
+		opcode << std::hex << std::setfill('0') << (op < 0x100 ? "0x" : "0xcb 0x") << std::setw(2) << (op & 0xff);
+		write(out, opcode.str(), info(op).mnemonic, time({op}));
+	}
+
+	// loops found in games: arithmetic, moving data, branching, bit twiddling
+	const std::array<std::pair<const char*, std::vector<Op>>, 4> mixes{{
+		{ "ALU", { 0x80, 0xa8, 0x91, 0x0c, 0xa2, 0xb3, 0x89, 0xfe, 0x3d, 0xc6 } },
+		{ "loads", { 0x7e, 0x22, 0x47, 0x1a, 0x12, 0xf0, 0xe0, 0x3e, 0xea, 0xfa } },
+		{ "branches", { 0x05, 0x20, 0xc5, 0xcd, 0xd1, 0x18, 0xc2, 0xe5, 0xe1, 0xc3 } },
+		{ "bits", { 0x101, 0x13a, 0x133, 0x159, 0x1ce, 0x18e, 0x116, 0x17e, 0x127, 0x11b } },
+	}};
+	for (const auto& mix : mixes) {
+		write(out, "mix", mix.first, time(mix.second));
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <iosfwd>
+
+// Times every implemented opcode (base and CB) on its own and a few mixes of them, stepping the
+// switch engine through 64 instructions at a time on an array-backed bus. Writes one CSV line per
+// opcode or mix: ns per instruction (mean and standard deviation over the runs), cycles per
+// instruction and emulated MHz.
+void benchOpcodes(std::ostream&);
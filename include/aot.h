@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+#include "types.h"
+#include "mapper.h"
+#include "codemap.h"
+
+// Code translated ahead of time by gb-aot: one C++ function per block of a ROM's code map, which
+// runs its instructions through BasicCPU<MMU>::runAot() with the opcodes and operands known at
+// compile time. The cached engines run a block's function instead of interpreting it wherever the
+// bytes it was translated from are mapped, everything else (RAM, code the map doesn't know, the
+// boot ROM) is interpreted as before. See CPU::setAot().
+struct AotBlock {
+	// IMMU::codeBank() of the address
+	BYTE bank;
+	WORD addr;
+	// the instructions, compared with memory before the function is used
+	const BYTE* bytes;
+	BYTE length;
+	// called with the BasicCPU<MMU> and the budget, returns the cycles taken
+	DWORD (*code)(void*, DWORD);
+};
+
+struct AotProgram {
+	// the cartridge header's global checksum (0x014e-0x014f)
+	WORD checksum;
+	const AotBlock* blocks;
+	std::size_t count;
+
+	// among the programs linked in, nullptr if there is none for the checksum
+	static const AotProgram* find(WORD checksum);
+};
+
+// A static one in the generated file makes its program known to AotProgram::find().
+class AotRegistration {
+	public:
+		explicit AotRegistration(const AotProgram&);
+};
+
+// the translation unit gb-aot writes for the ROM, the name goes into its header comment
+void writeAot(std::ostream&, Mapper&, const CodeMap&, const std::string& name);
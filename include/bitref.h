@@ -1,5 +1,7 @@
 #pragma once
 
+#include <type_traits>
+
 #include "types.h"
 
 // modelled after reference_wrapper (http://en.cppreference.com/w/cpp/utility/functional/reference_wrapper)
@@ -19,5 +21,6 @@ class BitRef {
 			m_ptr = static_cast<BYTE>((m_ptr & (~(1 << I))) | (rhs << I));
 		}
 	private:
-		T& m_ptr;
+		// proxies such as MemRef are held by value: BitRef<MemRef, I>{MemRef{...}} must not dangle
+		typename std::conditional<std::is_class<T>::value, T, T&>::type m_ptr;
 };
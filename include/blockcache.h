@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+// Straight-line runs of decoded instructions, keyed by the ROM bank (see IMMU::codeBank()) and
+// address of their first instruction.
+class BlockCache {
+	public:
+		struct Op {
+			BYTE opcode = 0;
+			BYTE n = 0;
+			WORD nn = 0;
+			// 0 for instructions with variable cycles (they set them themselves)
+			BYTE cycles = 0;
+			BYTE offset = 0;
+			// set if this and the next instruction form a superinstruction (see CPU::execSuperinstruction)
+			BYTE fused = 0;
+		};
+
+		struct Block {
+			std::vector<Op> ops;
+			// native translation (see Jit), once the block has been executed often enough
+			DWORD executions = 0;
+			// called with the BasicCPU, whatever its bus
+			DWORD (*code)(void*, DWORD) = nullptr;
+			// translated ahead of time (see aot.h), runs instead of ops and code
+			DWORD (*aot)(void*, DWORD) = nullptr;
+		};
+
+		Block* find(BYTE bank, WORD addr) {
+			auto it = m_blocks.find(key(bank, addr));
+			return (it != m_blocks.end()) ? &it->second : nullptr;
+		}
+		// blocks may span two pages, both are indexed
+		Block& insert(BYTE bank, WORD addr, BYTE firstPage, BYTE lastPage, Block&&);
+		void invalidatePage(BYTE);
+		void clear();
+	private:
+		using Key = DWORD;
+		static Key key(BYTE bank, WORD addr) {
+			return static_cast<Key>(bank << 16 | addr);
+		}
+		std::unordered_map<Key, Block> m_blocks;
+		std::array<std::vector<Key>, 256> m_pages;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <iosfwd>
+#include <vector>
+
+#include "types.h"
+#include "mapper.h"
+
+// What following the control flow from the entry points found in the ROM (0x0000-0x7fff): where
+// instructions start, which bytes are their operands and where basic blocks begin. Bytes that
+// aren't code are data, or code only reached through JP HL or a return address changed on the
+// stack. Saved maps are a header and one byte of flags per address, see gb-disasm.
+class CodeMap {
+	public:
+		enum Flag : BYTE {
+			// an instruction starts here
+			CODE = 0x01,
+			// the bytes after an opcode
+			OPERAND = 0x02,
+			// jumped or called to
+			LABEL = 0x04,
+			// entry points, labels and the instructions after branches, where the cached engine
+			// starts its blocks
+			BLOCK = 0x08,
+			// 0x0100, the RST vectors and the interrupt vectors
+			ENTRY = 0x10,
+		};
+		static const std::size_t SIZE = 0x8000;
+
+		// follows jumps, calls, returns and conditional branches from the entry points
+		static CodeMap discover(Mapper&);
+
+		BYTE flags(WORD addr) const {
+			return addr < SIZE ? m_flags[addr] : 0;
+		}
+		bool code(WORD addr) const {
+			return (flags(addr) & CODE) != 0;
+		}
+		// ascending
+		std::vector<WORD> blocks() const;
+
+		void write(std::ostream&) const;
+		// throws std::runtime_error if the stream doesn't hold a code map
+		static CodeMap read(std::istream&);
+
+		// one line per instruction (with labels) and up to 16 data bytes per DB line
+		void writeDisassembly(std::ostream&, Mapper&) const;
+	private:
+		std::array<BYTE, SIZE> m_flags{};
+};
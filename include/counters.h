@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+#include "types.h"
+
+// Hardware-style performance counters: plain integers that the CPU, the MMU and the GPU increment
+// where the events happen anyway. They only exist in builds with make COUNTERS=1 (GB_COUNTERS),
+// otherwise GB_COUNT() compiles to nothing and every counter stays 0. See Emulator::counters().
+struct Counters {
+	// the regions of the address space, by the MMU's branches; reads include instruction fetches,
+	// which the cached and JIT engines only do when decoding a block
+	enum Region : BYTE { ROM, VRAM, WRAM, OAM, IO, HRAM, REGIONS };
+
+#ifdef GB_COUNTERS
+	static constexpr bool enabled = true;
+#else
+	static constexpr bool enabled = false;
+#endif
+
+	uint64_t instructions = 0;
+	uint64_t cycles = 0;
+	std::array<uint64_t, REGIONS> reads{{0}};
+	std::array<uint64_t, REGIONS> writes{{0}};
+	// dispatched, not requested
+	uint64_t interrupts = 0;
+	uint64_t modeChanges = 0;
+	uint64_t dmaTransfers = 0;
+	// VBlanks entered
+	uint64_t frames = 0;
+
+	Counters& operator+=(const Counters&);
+
+	// one "<name> <value>" line per counter, e.g. "reads.wram 1234"
+	void write(std::ostream&) const;
+};
+
+#ifdef GB_COUNTERS
+#define GB_COUNT(statement) statement
+#else
+#define GB_COUNT(statement)
+#endif
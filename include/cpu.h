@@ -1,55 +1,330 @@
 #pragma once
 
+#include <exception>
+#include <iosfwd>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
 #include "mmu.h"
 #include "types.h"
 #include "instruction.h"
 #include "bitref.h"
+#include "cpustate.h"
 #include "interruptstate.h"
+#include "blockcache.h"
+#include "jit.h"
+#include "profiler.h"
+#include "trace.h"
+#include "debugger.h"
+#include "codemap.h"
+#include "opcodes.h"
+#include "aot.h"
+#include "counters.h"
+
+// The parts of the CPU that don't depend on the bus.
+class CPUBase {
+	public:
+		// Table: dispatch through the std::function entries in m_instructions
+		// Switch: dispatch through a dense switch over the exec<opcode> handlers
+		// Threaded: like Switch, but run() jumps from handler to handler (computed goto)
+		// Cached: like Switch, but run() executes basic blocks decoded ahead of time
+		// Jit: like Cached, but hot blocks are translated to x86-64 code (Cached on other hosts)
+		enum class Engine { Table, Switch, Threaded, Cached, Jit };
+	protected:
+		static bool readsFlags(BYTE);
+		static const std::array<bool, 256> s_readsFlags;
+#ifdef GB_ALU_TABLES
+		// Built with -DGB_ALU_TABLES (make ALU_TABLES=1), 8-bit arithmetic looks its result and flags
+		// up instead of computing them.
+		// AF after ADC: carry << 16 | A << 8 | operand, 256 KiB
+		static const std::array<WORD, 0x20000> s_addTable;
+		// AF after DAA: N, H and C (F & 0x70) << 4 | A
+		static const std::array<WORD, 0x800> s_daaTable;
+
+		static WORD addTable(BYTE a, BYTE operand, bool carry) {
+			return s_addTable[static_cast<std::size_t>(carry << 16 | a << 8 | operand)];
+		}
+		// A - operand - carry is A + ~operand + !carry with H and C complemented
+		static WORD subTable(BYTE a, BYTE operand, bool carry) {
+			return static_cast<WORD>(addTable(a, static_cast<BYTE>(~operand), !carry) ^ (FLAG_N | FLAG_H | FLAG_C));
+		}
+		static WORD daaTable(BYTE a, BYTE f) {
+			return s_daaTable[static_cast<std::size_t>((f & 0x70) << 4 | a)];
+		}
+#endif
+};
 
-class CPU {
+// The CPU reads and writes memory through a Bus (IMMU or a class derived from it). BasicCPU<MMU>
+// calls MMU's final readByte()/writeByte() directly, which inlines the accesses to ROM and RAM,
+// CPU dispatches every access virtually and runs on any IMMU.
+template <typename Bus>
+class BasicCPU : public CPUBase {
 	public:
-		CPU(IMMU&, InterruptState&, WORD = 0);
+		BasicCPU(Bus&, InterruptState&, Engine = Engine::Table);
 
 		DWORD step();
-		void handleInterrupts();
+		// dispatches the pending interrupt with the highest priority, if IME is set
+		void handleInterrupts() {
+			if (m_state.ime && m_intState.pending() != 0) {
+				dispatchInterrupt();
+			}
+		}
+
+		// executes instructions (and interrupts) until at least the given number of cycles has passed.
+		// A halted CPU skips straight to the end of the budget, so callers should end it at the next
+		// event that can request an interrupt (see Emulator).
+		DWORD run(DWORD);
+
+		// Lazy flags: the 8-bit ALU instructions only record their operands and result, Z/N/H/C
+		// are computed once an instruction needs them (or materializeFlags() is called).
+		void setLazyFlags(bool);
+		// brings f up to date, for anything reading the registers from outside
+		void materializeFlags();
+
+		// Idle-loop skipping: loops that only poll memory (e.g. LDH A, (0x44); CP 0x90; JR NZ) can't
+		// see a different value before the end of a run() budget, so all but the last iteration are skipped.
+		void setIdleSkipping(bool);
+		// emulated cycles skipped so far
+		uint64_t skippedCycles() const {
+			return m_skippedCycles;
+		}
+
+		// Superinstructions: the cached engine runs the opcode pairs listed in superinstructions.h
+		// through one fused handler (on by default).
+		void setSuperinstructions(bool);
+		// Pair profiling: run() steps one instruction at a time and counts every pair of opcodes.
+		void setPairProfiling(bool);
+		// writes the given number of most frequent pairs that can be fused, as superinstructions.h
+		void writeSuperinstructions(std::ostream&, std::size_t) const;
+
+		// Code maps (see gb-disasm): the cached and JIT engines decode the blocks the map lists
+		// ahead of time, and end blocks where the ROM's known code runs into bytes that aren't.
+		void setCodeMap(const CodeMap&);
+
+		// Profiling: run() steps one instruction at a time and reports every instruction, call
+		// and return to a Profiler, which starts at the current PC.
+		void setProfiling(bool);
+		// nullptr unless profiling
+		const Profiler* profiler() const {
+			return m_profiler.get();
+		}
+
+		// Tracing: run() steps one instruction at a time and records it in a ring buffer of the
+		// given number of entries (0 turns tracing off), e.g. to dump after a crash.
+		void setTracing(std::size_t);
+		// nullptr unless tracing
+		const Trace* trace() const {
+			return m_trace.get();
+		}
+
+		// Breakpoints: run() steps one instruction at a time while there are any. Reaching one calls
+		// the debugger, or starts the console single-stepper if there is none.
+		void setBreakpoint(WORD, bool = true);
+		// only while the ROM bank is mapped (0 outside of 0x4000-0x7fff)
+		void setBankBreakpoint(BYTE, WORD, bool = true);
+		// Debugging: run() steps one instruction at a time and calls the debugger before the first
+		// one, at breakpoints and whenever it asks to stop again (nullptr detaches it).
+		void setDebugger(Debugger*);
+		// stops before the next instruction, e.g. when the debugger is interrupted
+		void requestStop();
+
+		// Code translated by gb-aot, on BasicCPU<MMU> with the cached or JIT engine: blocks of the
+		// program run as its functions where memory holds the bytes they were translated from
+		// (nullptr interprets everything again).
+		void setAot(const AotProgram*);
+		// one instruction of a function written by gb-aot, false when the function has to return
+		// (the budget is used up, code changed or an interrupt is due)
+		template <BYTE opcode>
+		bool runAot(BYTE n_, WORD nn_, DWORD& total, DWORD budget) {
+			if (!registersOnly(opcode)) {
+				BlockCache::Op op{};
+				op.n = n_;
+				op.nn = nn_;
+				return execCached<opcode>(op, total, budget) == Next::CONTINUE;
+			}
+			// can't change code, IME or the pending interrupts, only the budget is checked
+			m_state.pc = static_cast<WORD>(m_state.pc + OPCODES[opcode].length);
+			n = n_;
+			nn = nn_;
+			prepareFlags(opcode);
+			exec<opcode>();
+			GB_COUNT(m_counters.instructions++);
+			m_state.cycles = OPCODES[opcode].cycles;
+			total += m_state.cycles;
+			return total < budget;
+		}
+
+		// instructions retired on every engine (not those of skipped idle loops) and interrupts dispatched
+		const Counters& counters() const {
+			return m_counters;
+		}
+
+		// registers, IME and HALT state (flags up to date), e.g. for save states and rewinding
+		CPUState snapshot() {
+			materializeFlags();
+			return m_state;
+		}
+		void restore(const CPUState& state) {
+			m_pending.op = LazyFlags::NONE;
+			m_state = state;
+		}
 	protected:
-		WORD m_breakpoint = 0;
+		Breakpoints m_breakpoints;
+		Debugger* m_debugger = nullptr;
+		bool m_stopRequested = false;
 		bool m_debugMode = false;
+		// run() steps (and step() checks breakpoints) while debugging, profiling or tracing,
+		// so that's the only check on the engines' way
+		bool m_stepping = false;
+		void updateStepping();
+		void stop();
 
-		IMMU& m_mmu;
+		Bus& m_mmu;
 		InterruptState& m_intState;
+		Engine m_engine;
 
-		WORD m_pc = 0;
-		WORD m_sp = 0;
-
-		WORD m_af = 0;
-		WORD m_bc = 0;
-		WORD m_de = 0;
-		WORD m_hl = 0;
-
-		BYTE& a{*(static_cast<BYTE*>(static_cast<void*>(&m_af)) + 1)};
-		BYTE& f{*(static_cast<BYTE*>(static_cast<void*>(&m_af)))};
-		BYTE& b{*(static_cast<BYTE*>(static_cast<void*>(&m_bc)) + 1)};
-		BYTE& c{*(static_cast<BYTE*>(static_cast<void*>(&m_bc)))};
-		BYTE& d{*(static_cast<BYTE*>(static_cast<void*>(&m_de)) + 1)};
-		BYTE& e{*(static_cast<BYTE*>(static_cast<void*>(&m_de)))};
-		BYTE& h{*(static_cast<BYTE*>(static_cast<void*>(&m_hl)) + 1)};
-		BYTE& l{*(static_cast<BYTE*>(static_cast<void*>(&m_hl)))};
-		
-		BitRef<BYTE, 7> m_zeroFlag{f};
-		BitRef<BYTE, 6> m_negFlag{f};
-		BitRef<BYTE, 5> m_halfFlag{f};
-		BitRef<BYTE, 4> m_carryFlag{f};
+		// registers, IME, HALT and the cycles of the last instruction
+		CPUState m_state;
+		Counters m_counters;
+
+		// the 8-bit registers are the halves of the register pairs (on little-endian hosts, like the JIT)
+		static BYTE& high(WORD& pair) {
+			return *(static_cast<BYTE*>(static_cast<void*>(&pair)) + 1);
+		}
+		static BYTE& low(WORD& pair) {
+			return *static_cast<BYTE*>(static_cast<void*>(&pair));
+		}
+		BYTE& a() { return high(m_state.af); }
+		BYTE& f() { return low(m_state.af); }
+#ifdef GB_ALU_TABLES
+		// keeps the low bits of F, like the flag BitRefs
+		void setAF(WORD af) { m_state.af = static_cast<WORD>(af | (f() & 0x0f)); }
+#endif
+		BYTE& b() { return high(m_state.bc); }
+		BYTE& c() { return low(m_state.bc); }
+		BYTE& d() { return high(m_state.de); }
+		BYTE& e() { return low(m_state.de); }
+		BYTE& h() { return high(m_state.hl); }
+		BYTE& l() { return low(m_state.hl); }
+
+		BitRef<BYTE, 7> zeroFlag() { return {f()}; }
+		BitRef<BYTE, 6> negFlag() { return {f()}; }
+		BitRef<BYTE, 5> halfFlag() { return {f()}; }
+		BitRef<BYTE, 4> carryFlag() { return {f()}; }
 
 		// immediate byte/word
 		BYTE n = 0;
 		WORD nn = 0;
 
-		// number of cycles of last instruction
-		DWORD m_cycles = 0;
+		// the last lazy ALU instruction, SUB covers SBC and CP, OR covers XOR
+		struct LazyFlags {
+			enum Op : BYTE { NONE, ADD, SUB, AND, OR, INC, DEC };
+			Op op = NONE;
+			BYTE lhs = 0;
+			BYTE rhs = 0;
+			BYTE carry = 0;
+			int result = 0;
+		};
+		bool m_lazyFlags = false;
+		LazyFlags m_pending;
+
+		// materializes pending flags if the instruction reads them or doesn't overwrite all of them lazily
+		void prepareFlags(BYTE opcode) {
+			if (m_pending.op != LazyFlags::NONE && s_readsFlags[opcode]) {
+				materializeFlags();
+			}
+		}
+		bool m_idleSkipping = false;
+		// the opcode step() fetched last, so run() sees a JR without reading it again
+		BYTE m_stepOpcode = 0;
+		uint64_t m_skippedCycles = 0;
+		// the last JR cc found not to close an idle loop (0x10000: none)
+		DWORD m_busyLoop = 0x10000;
+		// call after a taken JR cc with the cycles run so far and left in the budget, returns the cycles skipped
+		DWORD skipIdleLoop(DWORD, DWORD);
+		void dispatchInterrupt();
+		// cycles per iteration of the idle loop closed by the JR at the given address, 0 if it's not one
+		DWORD idleLoopCycles(WORD);
 
 		std::array<Instruction, 256> m_instructions;
-		std::array<Instruction, 256> m_extended;
+
+		// the CB-prefixed instructions, one handler per opcode generated by execCB()
+		using CBHandler = void (BasicCPU::*)();
+		template <std::size_t... opcodes>
+		static std::array<CBHandler, 256> cbHandlers(std::index_sequence<opcodes...>) {
+			return {{ &BasicCPU::execCB<static_cast<BYTE>(opcodes)>... }};
+		}
+		static const std::array<CBHandler, 256> s_cbHandlers;
+		template <BYTE opcode>
+		void execCB();
+		template <BYTE opcode>
+		void execCB(BYTE&);
+		// B, C, D, E, H, L, (HL), A: the operand in bits 0-2 of a CB opcode, not for (HL)
+		BYTE& cbRegister(BYTE operand) {
+			switch (operand) {
+			case 0: return b();
+			case 1: return c();
+			case 2: return d();
+			case 3: return e();
+			case 4: return h();
+			case 5: return l();
+			default: return a();
+			}
+		}
+
+		// one handler per opcode, defined in cpuimpl.h (same semantics as m_instructions)
+		template <BYTE opcode>
+		using Opcode = std::integral_constant<BYTE, opcode>;
+#define CPU_DECLARE_EXEC(op) void exec(Opcode<op>);
+		OPCODE_TABLE(CPU_DECLARE_EXEC)
+#undef CPU_DECLARE_EXEC
+		template <BYTE opcode>
+		void exec() {
+			exec(Opcode<opcode>{});
+		}
+		void execute(BYTE);
+		DWORD runThreaded(DWORD);
+
+		BlockCache m_blockCache;
+		std::unique_ptr<CodeMap> m_codeMap;
+		BlockCache::Block* decodeBlock(WORD);
+		DWORD runCached(DWORD);
+		// by bank << 16 | address, see setAot()
+		std::unordered_map<DWORD, const AotBlock*> m_aot;
+		decltype(BlockCache::Block::aot) aotCode(WORD);
+
+		// what runCached() does after an instruction
+		enum class Next { CONTINUE, LEAVE_BLOCK, RETURN };
+		template <BYTE opcode>
+		Next execCached(const BlockCache::Op&, DWORD&, DWORD);
+		template <BYTE first, BYTE second>
+		Next execFused(const BlockCache::Op*, DWORD&, DWORD);
+		Next execSuperinstruction(const BlockCache::Op*, DWORD&, DWORD);
+		bool m_superinstructions = true;
+
+		// counts of opcode pairs (first << 8 | second) while profiling
+		std::unique_ptr<std::array<uint64_t, 0x10000>> m_pairs;
+		BYTE m_lastOpcode = 0;
+
+		std::unique_ptr<Profiler> m_profiler;
+		Profiler::Location profilerLocation(WORD addr) const {
+			return Profiler::location(m_mmu.codeBank(addr), addr);
+		}
+
+		std::unique_ptr<Trace> m_trace;
+		void traceInstruction(WORD, BYTE);
+
+		std::unique_ptr<Jit> m_jit;
+		// exceptions can't pass through translated code, they are rethrown once it has returned
+		std::exception_ptr m_jitError;
+		static DWORD jitCallout(void*, DWORD, DWORD);
+
+		// two reads through the Bus (IMMU::readWord() is out of line)
+		WORD readWord(WORD addr) {
+			return static_cast<WORD>(m_mmu.readByte(addr) | m_mmu.readByte(static_cast<WORD>(addr + 1)) << 8);
+		}
 
 		// loads
 		template <typename T, typename S>
@@ -59,12 +334,12 @@ class CPU {
 		template <typename T, typename S>
 		void LDI(T& target, const S& source) {
 			target = source;
-			m_hl++;
+			m_state.hl++;
 		}
 		template <typename T, typename S>
 		void LDD(T& target, const S& source) {
 			target = source;
-			m_hl--;
+			m_state.hl--;
 		}
 		void LDadd();
 
@@ -85,21 +360,24 @@ class CPU {
 
 		template <WORD addr>
 		void RST() {
-			m_mmu.writeByte(m_sp-1, static_cast<BYTE>(m_pc >> 8));
-			m_mmu.writeByte(m_sp-2, static_cast<BYTE>(m_pc));
-			m_pc = addr;
-			m_sp -= 2;
+			m_mmu.writeByte(m_state.sp-1, static_cast<BYTE>(m_state.pc >> 8));
+			m_mmu.writeByte(m_state.sp-2, static_cast<BYTE>(m_state.pc));
+			m_state.pc = addr;
+			m_state.sp -= 2;
 		}
-		template <WORD addr, BYTE mask>
+		template <WORD addr, InterruptState::Source source>
 		void RST_INT() {
-			m_intState.ime = false;
-			m_mmu.writeByte(m_sp-1, static_cast<BYTE>(m_pc >> 8));
-			m_mmu.writeByte(m_sp-2, static_cast<BYTE>(m_pc));
-			m_pc = addr;
-			m_sp -= 2;
-
-			// disable flag
-			m_intState.intFlag ^= mask;
+			m_state.ime = false;
+			m_state.halted = false;
+			if (m_profiler) {
+				m_profiler->call(profilerLocation(addr), m_state.pc, m_state.pc);
+			}
+			m_mmu.writeByte(m_state.sp-1, static_cast<BYTE>(m_state.pc >> 8));
+			m_mmu.writeByte(m_state.sp-2, static_cast<BYTE>(m_state.pc));
+			m_state.pc = addr;
+			m_state.sp -= 2;
+
+			m_intState.acknowledge(source);
 		}
 
 		// 8bit arithmetic
@@ -125,10 +403,16 @@ class CPU {
 
 		template <typename T>
 		void INC(T& target) {
-			m_halfFlag = ((((target & 0xf) + 1) & 0xf0) != 0);
+			if (m_lazyFlags) {
+				BYTE old = target;
+				target = static_cast<BYTE>(old + 1);
+				m_pending = {LazyFlags::INC, old, 0, carryFlag(), static_cast<BYTE>(old + 1)};
+				return;
+			}
+			halfFlag() = ((((target & 0xf) + 1) & 0xf0) != 0);
 			target = static_cast<BYTE>(target + 1);
-			m_zeroFlag = (target == 0);
-			m_negFlag = false;
+			zeroFlag() = (target == 0);
+			negFlag() = false;
 		}
 		// Highly annoying: Can't specialize in class scope (for no apparent reason: https://cplusplus.github.io/EWG/ewg-active.html#41)
 		// template <>
@@ -138,15 +422,32 @@ class CPU {
 
 		template <typename T>
 		void DEC(T& target) {
-			m_halfFlag = ((target & 0xf) == 0);
+			if (m_lazyFlags) {
+				BYTE old = target;
+				target = static_cast<BYTE>(old - 1);
+				m_pending = {LazyFlags::DEC, old, 0, carryFlag(), static_cast<BYTE>(old - 1)};
+				return;
+			}
+			halfFlag() = ((target & 0xf) == 0);
 			target = static_cast<BYTE>(target - 1);
-			m_zeroFlag = (target == 0);
-			m_negFlag = true;
+			zeroFlag() = (target == 0);
+			negFlag() = true;
 		}
 		// template <>
 		void DEC(WORD& target) {
 			target--;
 		}
+		// INC (HL), DEC (HL): one read and one write, like the CB (HL) handlers
+		void INCmem() {
+			BYTE value = m_mmu.readByte(m_state.hl);
+			INC(value);
+			m_mmu.writeByte(m_state.hl, value);
+		}
+		void DECmem() {
+			BYTE value = m_mmu.readByte(m_state.hl);
+			DEC(value);
+			m_mmu.writeByte(m_state.hl, value);
+		}
 
 		// shift and rotate
 		void RLCA();
@@ -158,87 +459,88 @@ class CPU {
 		void CB();
 		void EI();
 		void DI();
+		void HALT();
 
 		// extended instruction set
 		template <typename T>
 		void RLC(T& target) {
-			m_carryFlag = ((target >> 7) != 0);
-			target = static_cast<BYTE>(static_cast<BYTE>(target << 1) | m_carryFlag);
-			m_zeroFlag = (target == 0);
-			m_halfFlag = false;
-			m_negFlag = false;
+			carryFlag() = ((target >> 7) != 0);
+			target = static_cast<BYTE>(static_cast<BYTE>(target << 1) | carryFlag());
+			zeroFlag() = (target == 0);
+			halfFlag() = false;
+			negFlag() = false;
 		}
 
 		template <typename T>
 		void RRC(T& target) {
-			m_carryFlag = ((target & 0x1) != 0);
-			target = static_cast<BYTE>(static_cast<BYTE>(target >> 1) | (m_carryFlag << 7));
-			m_zeroFlag = (target == 0);
-			m_halfFlag = false;
-			m_negFlag = false;
+			carryFlag() = ((target & 0x1) != 0);
+			target = static_cast<BYTE>(static_cast<BYTE>(target >> 1) | (carryFlag() << 7));
+			zeroFlag() = (target == 0);
+			halfFlag() = false;
+			negFlag() = false;
 		}
 
 		template <typename T>
 		void RL(T& target) {
-			bool temp = m_carryFlag;
-			m_carryFlag = ((target >> 7) != 0);
+			bool temp = carryFlag();
+			carryFlag() = ((target >> 7) != 0);
 			target = static_cast<BYTE>((target << 1) | temp);
-			m_zeroFlag = (target == 0);
-			m_halfFlag = false;
-			m_negFlag = false;
+			zeroFlag() = (target == 0);
+			halfFlag() = false;
+			negFlag() = false;
 		}
 
 		template <typename T>
 		void RR(T& target) {
-			bool temp = m_carryFlag;
-			m_carryFlag = ((target & 0x1) != 0);
+			bool temp = carryFlag();
+			carryFlag() = ((target & 0x1) != 0);
 			target = static_cast<BYTE>((target >> 1) | (temp << 7));
-			m_zeroFlag = (target == 0);
-			m_halfFlag = false;
-			m_negFlag = false;
+			zeroFlag() = (target == 0);
+			halfFlag() = false;
+			negFlag() = false;
 		}
 
 		template <typename T>
 		void SLA(T& target) {
-			m_carryFlag = ((target >> 7) != 0);
+			carryFlag() = ((target >> 7) != 0);
 			target = static_cast<BYTE>(target << 1);
-			m_zeroFlag = (target == 0);
-			m_halfFlag = false;
-			m_negFlag = false;
+			zeroFlag() = (target == 0);
+			halfFlag() = false;
+			negFlag() = false;
 		}
 
 		template <typename T>
 		void SRA(T& target) {
-			m_carryFlag = ((target & 0x1) != 0);
+			carryFlag() = ((target & 0x1) != 0);
 			target = static_cast<BYTE>((target >> 1) | (target & 0b10000000));
-			m_zeroFlag = (target == 0);
-			m_halfFlag = false;
-			m_negFlag = false;
+			zeroFlag() = (target == 0);
+			halfFlag() = false;
+			negFlag() = false;
 		}
 
 		template <typename T>
 		void SWAP(T& target) {
 			target = static_cast<BYTE>((target >> 4) | (target << 4));
-			m_zeroFlag = (target == 0);
-			m_carryFlag = false;
-			m_halfFlag = false;
-			m_negFlag = false;
+			zeroFlag() = (target == 0);
+			carryFlag() = false;
+			halfFlag() = false;
+			negFlag() = false;
 		}
 
 		template <typename T>
 		void SRL(T& target) {
-			m_carryFlag = ((target & 0x1) != 0);
+			carryFlag() = ((target & 0x1) != 0);
 			target = static_cast<BYTE>(target >> 1);
-			m_zeroFlag = (target == 0);
-			m_halfFlag = false;
-			m_negFlag = false;
+			zeroFlag() = (target == 0);
+			halfFlag() = false;
+			negFlag() = false;
 		}
 
 		template <typename T>
 		void BIT(const T& target) {
-			m_zeroFlag = !target;
-			m_negFlag = false;
-			m_halfFlag = true;
+			zeroFlag() = !target;
+			negFlag() = false;
+			halfFlag() = true;
 		}
 
 		template <typename T>
@@ -251,3 +553,8 @@ class CPU {
 			target = true;
 		}
 };
+
+using CPU = BasicCPU<IMMU>;
+
+extern template class BasicCPU<IMMU>;
+extern template class BasicCPU<MMU>;
@@ -0,0 +1,1842 @@
+#pragma once
+
+// Member definitions of BasicCPU. source/cpu.cpp instantiates them for IMMU and MMU, include
+// this instead of cpu.h to run the CPU on another bus (e.g. the tests' TestMMU).
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <bitset>
+#include <vector>
+
+#include "cpu.h"
+#include "opcodes.h"
+#include "memref.h"
+#include "offsetref.h"
+#include "superinstructions.h"
+
+template <typename Bus>
+BasicCPU<Bus>::BasicCPU(Bus& m_mmu_, InterruptState& m_intState_, Engine m_engine_) :
+	m_mmu{m_mmu_},
+	m_intState{m_intState_},
+	m_engine{m_engine_}
+{
+	m_instructions = {{
+		{ 0x00, [](){} }, // NOP
+		{ 0x01, std::bind(&BasicCPU::LD<WORD, WORD>, 	this, std::ref(m_state.bc), std::cref(nn)) }, 	// LD BC, nn
+		{ 0x02, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>,	this, MemRef<Bus>{m_state.bc, m_mmu}, std::cref(a())) },	// LD (BC), A
+		{ 0x03, std::bind<void(BasicCPU::*)(WORD&)>(&BasicCPU::INC, this, std::ref(m_state.bc)) },			// INC BC
+		{ 0x04, std::bind(&BasicCPU::INC<BYTE>,		this, std::ref(b())) },			// INC B
+		{ 0x05, std::bind(&BasicCPU::DEC<BYTE>,		this, std::ref(b())) },			// DEC B
+		{ 0x06, std::bind(&BasicCPU::LD<BYTE, BYTE>, 	this, std::ref(b()), std::cref(n)) }, 	// LD B, n
+		{ 0x07, std::bind(&BasicCPU::RLCA,			this) },					// RLCA
+		{ 0x08, std::bind(&BasicCPU::LD<MemRef<Bus>, WORD>,	this, MemRef<Bus>{nn, m_mmu}, std::cref(m_state.sp)) },	// LD (nn), SP
+		{ 0x09, std::bind<void(BasicCPU::*)(WORD&, const WORD&)>(&BasicCPU::ADD, this, std::ref(m_state.hl), std::cref(m_state.bc)) }, // ADD HL, BC
+		{ 0x0a, std::bind(&BasicCPU::LD<BYTE, MemRef<Bus>>,	this, std::ref(a()), MemRef<Bus>{m_state.bc, m_mmu}) },	// LD A, (BC)
+		{ 0x0b, std::bind<void(BasicCPU::*)(WORD&)>(&BasicCPU::DEC, this, std::ref(m_state.bc)) }, 			// DEC BC
+		{ 0x0c, std::bind(&BasicCPU::INC<BYTE>,		this, std::ref(c())) },			// INC C
+		{ 0x0d, std::bind(&BasicCPU::DEC<BYTE>,		this, std::ref(c())) },			// DEC C
+		{ 0x0e, std::bind(&BasicCPU::LD<BYTE, BYTE>, 	this, std::ref(c()), std::cref(n)) }, 	// LD C, n
+		{ 0x0f, std::bind(&BasicCPU::RRCA,			this) },					// RRCA
+
+		{},
+		{ 0x11, std::bind(&BasicCPU::LD<WORD, WORD>, 	this, std::ref(m_state.de), std::cref(nn)) }, 	// LD DE, nn
+		{ 0x12, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>,	this, MemRef<Bus>{m_state.de, m_mmu}, std::cref(a())) },	// LD (DE), A
+		{ 0x13, std::bind<void(BasicCPU::*)(WORD&)>(&BasicCPU::INC, this, std::ref(m_state.de)) }, 			// INC DE
+		{ 0x14, std::bind(&BasicCPU::INC<BYTE>,		this, std::ref(d())) },			// INC D
+		{ 0x15, std::bind(&BasicCPU::DEC<BYTE>,		this, std::ref(d())) },			// DEC D
+		{ 0x16, std::bind(&BasicCPU::LD<BYTE, BYTE>, 	this, std::ref(d()), std::cref(n)) }, 	// LD D, n
+		{ 0x17, std::bind(&BasicCPU::RLA,			this) },					// RLA
+		{ 0x18, std::bind(&BasicCPU::JR,			this, true, std::cref(n)) },		// JR n
+		{ 0x19, std::bind<void(BasicCPU::*)(WORD&, const WORD&)>(&BasicCPU::ADD, this, std::ref(m_state.hl), std::cref(m_state.de)) }, // ADD HL, DE
+		{ 0x1a, std::bind(&BasicCPU::LD<BYTE, MemRef<Bus>>,	this, std::ref(a()), MemRef<Bus>{m_state.de, m_mmu}) },	// LD A, (DE)
+		{ 0x1b, std::bind<void(BasicCPU::*)(WORD&)>(&BasicCPU::DEC, this, std::ref(m_state.de)) }, 			// DEC DE
+		{ 0x1c, std::bind(&BasicCPU::INC<BYTE>,		this, std::ref(e())) },			// INC E
+		{ 0x1d, std::bind(&BasicCPU::DEC<BYTE>,		this, std::ref(e())) },			// DEC E
+		{ 0x1e, std::bind(&BasicCPU::LD<BYTE, BYTE>, 	this, std::ref(e()), std::cref(n)) }, 	// LD E, n
+		{ 0x1f, std::bind(&BasicCPU::RRA,			this) },					// RRA
+
+		{ 0x20, std::bind(&BasicCPU::JRn,			this, zeroFlag(), std::cref(n)) },		// JR NZ, n
+		{ 0x21, std::bind(&BasicCPU::LD<WORD, WORD>, 	this, std::ref(m_state.hl), std::cref(nn)) }, 	// LD HL, nn
+		{ 0x22, std::bind(&BasicCPU::LDI<MemRef<Bus>, BYTE>,	this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(a())) },	// LDI (HL+), A
+		{ 0x23, std::bind<void(BasicCPU::*)(WORD&)>(&BasicCPU::INC, this, std::ref(m_state.hl)) }, 			// INC HL
+		{ 0x24, std::bind(&BasicCPU::INC<BYTE>,		this, std::ref(h())) },			// INC H
+		{ 0x25, std::bind(&BasicCPU::DEC<BYTE>,		this, std::ref(h())) },			// DEC H
+		{ 0x26, std::bind(&BasicCPU::LD<BYTE, BYTE>, 	this, std::ref(h()), std::cref(n)) }, 	// LD H, n
+		{ 0x27, std::bind(&BasicCPU::DAA,			this) },					// DAA
+		{ 0x28, std::bind(&BasicCPU::JR,			this, zeroFlag(), std::cref(n)) },		// JR Z, n
+		{ 0x29, std::bind<void(BasicCPU::*)(WORD&, const WORD&)>(&BasicCPU::ADD, this, std::ref(m_state.hl), std::cref(m_state.hl)) }, // ADD HL, HL
+		{ 0x2a, std::bind(&BasicCPU::LDI<BYTE, MemRef<Bus>>,	this, std::ref(a()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LDI A, (HL+)
+		{ 0x2b, std::bind<void(BasicCPU::*)(WORD&)>(&BasicCPU::DEC, this, std::ref(m_state.hl)) }, 			// DEC HL
+		{ 0x2c, std::bind(&BasicCPU::INC<BYTE>,		this, std::ref(l())) },			// INC L
+		{ 0x2d, std::bind(&BasicCPU::DEC<BYTE>,		this, std::ref(l())) },			// DEC L
+		{ 0x2e, std::bind(&BasicCPU::LD<BYTE, BYTE>, 	this, std::ref(l()), std::cref(n)) }, 	// LD L, n
+		{ 0x2f, std::bind(&BasicCPU::CPL,			this) },					// CPL
+
+		{ 0x30, std::bind(&BasicCPU::JRn,			this, carryFlag(), std::cref(n)) },		// JR NC, n
+		{ 0x31, std::bind(&BasicCPU::LD<WORD, WORD>, 	this, std::ref(m_state.sp), std::cref(nn)) }, 	// LD SP, nn
+		{ 0x32, std::bind(&BasicCPU::LDD<MemRef<Bus>, BYTE>,	this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(a())) },	// LDD (HL-), A
+		{ 0x33, std::bind<void(BasicCPU::*)(WORD&)>(&BasicCPU::INC, this, std::ref(m_state.sp)) }, 			// INC SP
+		{ 0x34, std::bind(&BasicCPU::INCmem,		this) },					// INC (HL)
+		{ 0x35, std::bind(&BasicCPU::DECmem,		this) },					// DEC (HL)
+		{ 0x36, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>,	this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(n)) },	// LD (HL), N
+		{ 0x37, std::bind(&BasicCPU::SCF,			this) },					// SCF
+		{ 0x38, std::bind(&BasicCPU::JR,			this, carryFlag(), std::cref(n)) },		// JR C, n
+		{ 0x39, std::bind<void(BasicCPU::*)(WORD&, const WORD&)>(&BasicCPU::ADD, this, std::ref(m_state.hl), std::cref(m_state.sp)) }, // ADD HL, SP
+		{ 0x3a, std::bind(&BasicCPU::LDD<BYTE, MemRef<Bus>>,	this, std::ref(a()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LDD A, (HL-)
+		{ 0x3b, std::bind<void(BasicCPU::*)(WORD&)>(&BasicCPU::DEC, this, std::ref(m_state.sp)) }, 			// DEC SP
+		{ 0x3c, std::bind(&BasicCPU::INC<BYTE>,		this, std::ref(a())) },			// INC A
+		{ 0x3d, std::bind(&BasicCPU::DEC<BYTE>,		this, std::ref(a())) },			// DEC A
+		{ 0x3e, std::bind(&BasicCPU::LD<BYTE, BYTE>, 	this, std::ref(a()), std::cref(n)) }, 	// LD A, n
+		{ 0x3f, std::bind(&BasicCPU::CCF,			this) },					// CCF
+
+		{ 0x40, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(b()), std::cref(b())) },	// LD B, B
+		{ 0x41, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(b()), std::cref(c())) },	// LD B, C
+		{ 0x42, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(b()), std::cref(d())) },	// LD B, D
+		{ 0x43, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(b()), std::cref(e())) },	// LD B, E
+		{ 0x44, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(b()), std::cref(h())) },	// LD B, H
+		{ 0x45, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(b()), std::cref(l())) },	// LD B, L
+		{ 0x46, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(b()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LD B, (HL)
+		{ 0x47, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(b()), std::cref(a())) },	// LD B, A
+		{ 0x48, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(c()), std::cref(b())) },	// LD C, B
+		{ 0x49, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(c()), std::cref(c())) },	// LD C, C
+		{ 0x4a, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(c()), std::cref(d())) },	// LD C, D
+		{ 0x4b, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(c()), std::cref(e())) },	// LD C, E
+		{ 0x4c, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(c()), std::cref(h())) },	// LD C, H
+		{ 0x4d, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(c()), std::cref(l())) },	// LD C, L
+		{ 0x4e, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(c()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LD C, (HL)
+		{ 0x4f, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(c()), std::cref(a())) },	// LD C, A
+
+		{ 0x50, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(d()), std::cref(b())) },	// LD D, B
+		{ 0x51, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(d()), std::cref(c())) },	// LD D, C
+		{ 0x52, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(d()), std::cref(d())) },	// LD D, D
+		{ 0x53, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(d()), std::cref(e())) },	// LD D, E
+		{ 0x54, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(d()), std::cref(h())) },	// LD D, H
+		{ 0x55, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(d()), std::cref(l())) },	// LD D, L
+		{ 0x56, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(d()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LD D, (HL)
+		{ 0x57, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(d()), std::cref(a())) },	// LD D, A
+		{ 0x58, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(e()), std::cref(b())) },	// LD E, B
+		{ 0x59, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(e()), std::cref(c())) },	// LD E, C
+		{ 0x5a, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(e()), std::cref(d())) },	// LD E, D
+		{ 0x5b, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(e()), std::cref(e())) },	// LD E, E
+		{ 0x5c, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(e()), std::cref(h())) },	// LD E, H
+		{ 0x5d, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(e()), std::cref(l())) },	// LD E, L
+		{ 0x5e, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(e()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LD E, (HL)
+		{ 0x5f, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(e()), std::cref(a())) },	// LD E, A
+
+		{ 0x60, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(h()), std::cref(b())) },	// LD H, B
+		{ 0x61, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(h()), std::cref(c())) },	// LD H, C
+		{ 0x62, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(h()), std::cref(d())) },	// LD H, D
+		{ 0x63, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(h()), std::cref(e())) },	// LD H, E
+		{ 0x64, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(h()), std::cref(h())) },	// LD H, H
+		{ 0x65, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(h()), std::cref(l())) },	// LD H, L
+		{ 0x66, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(h()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LD H, (HL)
+		{ 0x67, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(h()), std::cref(a())) },	// LD H, A
+		{ 0x68, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(l()), std::cref(b())) },	// LD L, B
+		{ 0x69, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(l()), std::cref(c())) },	// LD L, C
+		{ 0x6a, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(l()), std::cref(d())) },	// LD L, D
+		{ 0x6b, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(l()), std::cref(e())) },	// LD L, E
+		{ 0x6c, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(l()), std::cref(h())) },	// LD L, H
+		{ 0x6d, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(l()), std::cref(l())) },	// LD L, L
+		{ 0x6e, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(l()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LD L, (HL)
+		{ 0x6f, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(l()), std::cref(a())) },	// LD L, A
+
+		{ 0x70, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>, this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(b())) },	// LD (HL), B
+		{ 0x71, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>, this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(c())) },	// LD (HL), C
+		{ 0x72, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>, this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(d())) },	// LD (HL), D
+		{ 0x73, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>, this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(e())) },	// LD (HL), E
+		{ 0x74, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>, this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(h())) },	// LD (HL), H
+		{ 0x75, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>, this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(l())) },	// LD (HL), L
+		{ 0x76, std::bind(&BasicCPU::HALT,		this) },					// HALT
+		{ 0x77, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>, this, MemRef<Bus>{m_state.hl, m_mmu}, std::cref(a())) },	// LD (HL), A
+		{ 0x78, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(a()), std::cref(b())) },	// LD A, B
+		{ 0x79, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(a()), std::cref(c())) },	// LD A, C
+		{ 0x7a, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(a()), std::cref(d())) },	// LD A, D
+		{ 0x7b, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(a()), std::cref(e())) },	// LD A, E
+		{ 0x7c, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(a()), std::cref(h())) },	// LD A, H
+		{ 0x7d, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(a()), std::cref(l())) },	// LD A, L
+		{ 0x7e, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(a()), MemRef<Bus>{m_state.hl, m_mmu}) },	// LD A, (HL)
+		{ 0x7f, std::bind(&BasicCPU::LD<BYTE, BYTE>,	this, std::ref(a()), std::cref(a())) },	// LD A, A
+
+		{ 0x80, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, std::cref(b())) },		// ADD A, B
+		{ 0x81, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, std::cref(c())) },		// ADD A, C
+		{ 0x82, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, std::cref(d())) },		// ADD A, D
+		{ 0x83, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, std::cref(e())) },		// ADD A, E
+		{ 0x84, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, std::cref(h())) },		// ADD A, H
+		{ 0x85, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, std::cref(l())) },		// ADD A, L
+		{ 0x86, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, MemRef<Bus>{m_state.hl, m_mmu}) },		// ADD A, (HL)
+		{ 0x87, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, std::cref(a())) },		// ADD A, A
+		{ 0x88, std::bind(&BasicCPU::ADC,		this, std::cref(b())) },			// ADC A, B
+		{ 0x89, std::bind(&BasicCPU::ADC,		this, std::cref(c())) },			// ADC A, C
+		{ 0x8a, std::bind(&BasicCPU::ADC,		this, std::cref(d())) },			// ADC A, D
+		{ 0x8b, std::bind(&BasicCPU::ADC,		this, std::cref(e())) },			// ADC A, E
+		{ 0x8c, std::bind(&BasicCPU::ADC,		this, std::cref(h())) },			// ADC A, H
+		{ 0x8d, std::bind(&BasicCPU::ADC,		this, std::cref(l())) },			// ADC A, L
+		{ 0x8e, std::bind(&BasicCPU::ADC,		this, MemRef<Bus>{m_state.hl, m_mmu}) },			// ADC A, (HL)
+		{ 0x8f, std::bind(&BasicCPU::ADC,		this, std::cref(a())) },			// ADC A, A
+
+		{ 0x90, std::bind(&BasicCPU::SUB,		this, std::cref(b())) },			// SUB A, B
+		{ 0x91, std::bind(&BasicCPU::SUB,		this, std::cref(c())) },			// SUB A, C
+		{ 0x92, std::bind(&BasicCPU::SUB,		this, std::cref(d())) },			// SUB A, D
+		{ 0x93, std::bind(&BasicCPU::SUB,		this, std::cref(e())) },			// SUB A, E
+		{ 0x94, std::bind(&BasicCPU::SUB,		this, std::cref(h())) },			// SUB A, H
+		{ 0x95, std::bind(&BasicCPU::SUB,		this, std::cref(l())) },			// SUB A, L
+		{ 0x96, std::bind(&BasicCPU::SUB,		this, MemRef<Bus>{m_state.hl, m_mmu}) },			// SUB A, (HL)
+		{ 0x97, std::bind(&BasicCPU::SUB,		this, std::cref(a())) },			// SUB A, A
+		{ 0x98, std::bind(&BasicCPU::SBC,		this, std::cref(b())) },			// SBC A, B
+		{ 0x99, std::bind(&BasicCPU::SBC,		this, std::cref(c())) },			// SBC A, C
+		{ 0x9a, std::bind(&BasicCPU::SBC,		this, std::cref(d())) },			// SBC A, D
+		{ 0x9b, std::bind(&BasicCPU::SBC,		this, std::cref(e())) },			// SBC A, E
+		{ 0x9c, std::bind(&BasicCPU::SBC,		this, std::cref(h())) },			// SBC A, H
+		{ 0x9d, std::bind(&BasicCPU::SBC,		this, std::cref(l())) },			// SBC A, L
+		{ 0x9e, std::bind(&BasicCPU::SBC,		this, MemRef<Bus>{m_state.hl, m_mmu}) },			// SBC A, (HL)
+		{ 0x9f, std::bind(&BasicCPU::SBC,		this, std::cref(a())) },			// SBC A, A
+
+		{ 0xa0, std::bind(&BasicCPU::AND,		this, std::cref(b())) },			// AND A, B
+		{ 0xa1, std::bind(&BasicCPU::AND,		this, std::cref(c())) },			// AND A, C
+		{ 0xa2, std::bind(&BasicCPU::AND,		this, std::cref(d())) },			// AND A, D
+		{ 0xa3, std::bind(&BasicCPU::AND,		this, std::cref(e())) },			// AND A, E
+		{ 0xa4, std::bind(&BasicCPU::AND,		this, std::cref(h())) },			// AND A, H
+		{ 0xa5, std::bind(&BasicCPU::AND,		this, std::cref(l())) },			// AND A, L
+		{ 0xa6, std::bind(&BasicCPU::AND,		this, MemRef<Bus>{m_state.hl, m_mmu}) },			// AND A, (HL)
+		{ 0xa7, std::bind(&BasicCPU::AND,		this, std::cref(a())) },			// AND A, A
+		{ 0xa8, std::bind(&BasicCPU::XOR,		this, std::cref(b())) },			// XOR A, B
+		{ 0xa9, std::bind(&BasicCPU::XOR,		this, std::cref(c())) },			// XOR A, C
+		{ 0xaa, std::bind(&BasicCPU::XOR,		this, std::cref(d())) },			// XOR A, D
+		{ 0xab, std::bind(&BasicCPU::XOR,		this, std::cref(e())) },			// XOR A, E
+		{ 0xac, std::bind(&BasicCPU::XOR,		this, std::cref(h())) },			// XOR A, H
+		{ 0xad, std::bind(&BasicCPU::XOR,		this, std::cref(l())) },			// XOR A, L
+		{ 0xae, std::bind(&BasicCPU::XOR,		this, MemRef<Bus>{m_state.hl, m_mmu}) },			// XOR A, (HL)
+		{ 0xaf, std::bind(&BasicCPU::XOR,		this, std::cref(a())) },			// XOR A, A
+
+		{ 0xb0, std::bind(&BasicCPU::OR,		this, std::cref(b())) },			// OR A, B
+		{ 0xb1, std::bind(&BasicCPU::OR,		this, std::cref(c())) },			// OR A, C
+		{ 0xb2, std::bind(&BasicCPU::OR,		this, std::cref(d())) },			// OR A, D
+		{ 0xb3, std::bind(&BasicCPU::OR,		this, std::cref(e())) },			// OR A, E
+		{ 0xb4, std::bind(&BasicCPU::OR,		this, std::cref(h())) },			// OR A, H
+		{ 0xb5, std::bind(&BasicCPU::OR,		this, std::cref(l())) },			// OR A, L
+		{ 0xb6, std::bind(&BasicCPU::OR,		this, MemRef<Bus>{m_state.hl, m_mmu}) },			// OR A, (HL)
+		{ 0xb7, std::bind(&BasicCPU::OR,		this, std::cref(a())) },			// OR A, A
+		{ 0xb8, std::bind(&BasicCPU::CP,		this, std::cref(b())) },			// CP A, B
+		{ 0xb9, std::bind(&BasicCPU::CP,		this, std::cref(c())) },			// CP A, C
+		{ 0xba, std::bind(&BasicCPU::CP,		this, std::cref(d())) },			// CP A, D
+		{ 0xbb, std::bind(&BasicCPU::CP,		this, std::cref(e())) },			// CP A, E
+		{ 0xbc, std::bind(&BasicCPU::CP,		this, std::cref(h())) },			// CP A, H
+		{ 0xbd, std::bind(&BasicCPU::CP,		this, std::cref(l())) },			// CP A, L
+		{ 0xbe, std::bind(&BasicCPU::CP,		this, MemRef<Bus>{m_state.hl, m_mmu}) },			// CP A, (HL)
+		{ 0xbf, std::bind(&BasicCPU::CP,		this, std::cref(a())) },			// CP A, A
+		
+		{ 0xc0, std::bind(&BasicCPU::RETncond,	this, zeroFlag()) },			// RET NZ
+		{ 0xc1, std::bind(&BasicCPU::POP,		this, std::ref(m_state.bc)) },			// POP BC
+		{ 0xc2, std::bind(&BasicCPU::JPn,		this, zeroFlag(),	std::cref(nn)) },		// JP NZ, nn
+		{ 0xc3, std::bind(&BasicCPU::JP,		this, true, std::cref(nn)) },		// JP nn
+		{}, // 0xc4
+		{ 0xc5, std::bind(&BasicCPU::PUSH,		this, std::cref(m_state.bc)) },			// PUSH BC
+		{ 0xc6, std::bind<void(BasicCPU::*)(const BYTE&)>(&BasicCPU::ADD,	this, std::cref(n)) },		// ADD A, n
+		{}, // 0xc7
+		{ 0xc8, std::bind(&BasicCPU::RETcond,	this, zeroFlag()) },			// RET Z
+		{ 0xc9, std::bind(&BasicCPU::RET,		this) },					// RET !!!
+		{ 0xca, std::bind(&BasicCPU::JP,		this, zeroFlag(), std::cref(nn)) },		// JP Z, nn
+		{ 0xcb, std::bind(&BasicCPU::CB,		this) },					// CB (cycles set by CB())
+		{}, // 0xcc
+		{ 0xcd, std::bind(&BasicCPU::CALL,		this, std::cref(nn)) },			// CALL nn !!!
+		{ 0xce, std::bind(&BasicCPU::ADC,		this, std::cref(n)) },			// ADC A, n
+		{ 0xcf, std::bind(&BasicCPU::RST<0x0008>,	this) },					// RST 0x0008 !!!
+		
+		{ 0xd0, std::bind(&BasicCPU::RETncond,	this, carryFlag()) },			// RET NC
+		{ 0xd1, std::bind(&BasicCPU::POP,		this, std::ref(m_state.de)) },			// POP DE
+		{ 0xd2, std::bind(&BasicCPU::JPn,		this, carryFlag(), std::cref(nn)) },	// JP NC, nn
+		{}, // 0xd3
+		{}, // 0xd4
+		{ 0xd5, std::bind(&BasicCPU::PUSH,		this, std::cref(m_state.de)) },			// PUSH DE
+		{ 0xd6, std::bind(&BasicCPU::SUB,		this, std::cref(n)) },			// SUB A, n
+		{}, // 0xd7
+		{ 0xd8, std::bind(&BasicCPU::RETcond,	this, carryFlag()) },			// RET C
+		{ 0xd9, std::bind(&BasicCPU::RETI,		this) },					// RETI
+		{ 0xda, std::bind(&BasicCPU::JP,		this, carryFlag(), std::cref(nn)) },	// JP C, nn
+		{}, // 0xdb
+		{}, // 0xdc
+		{}, // 0xdd
+		{ 0xde, std::bind(&BasicCPU::SBC,		this, std::cref(n)) },			// SBC A, n
+		{ 0xdf, std::bind(&BasicCPU::RST<0x0018>,	this) },					// RST 0x0018 !!!
+		
+		{ 0xe0, std::bind(&BasicCPU::LD<OffsetRef<0xff00, Bus>, BYTE>, this, OffsetRef<0xff00, Bus>{n, m_mmu}, std::cref(a())) }, // LD (N+0xff00), A
+		{ 0xe1, std::bind(&BasicCPU::POP,		this, std::ref(m_state.hl)) },			// POP HL
+		{ 0xe2, std::bind(&BasicCPU::LD<OffsetRef<0xff00, Bus>, BYTE>, this, OffsetRef<0xff00, Bus>{c(), m_mmu}, std::cref(a())) }, // LD (C+0xff00), A
+		{}, // 0xe3
+		{}, // 0xe4
+		{ 0xe5, std::bind(&BasicCPU::PUSH,		this, std::cref(m_state.hl)) },			// PUSH HL
+		{ 0xe6, std::bind(&BasicCPU::AND,		this, std::cref(n)) },			// AND A, n
+		{}, // 0xe7
+		{ 0xe8, std::bind<void(BasicCPU::*)()>(&BasicCPU::ADD, this) }, // ADD SP, n
+		{ 0xe9, std::bind(&BasicCPU::JP,		this, true, std::cref(m_state.hl)) },		// JP HL !!! docs say (HL) but this is wrong (and makes little sense)
+		{ 0xea, std::bind(&BasicCPU::LD<MemRef<Bus>, BYTE>, this, MemRef<Bus>{nn, m_mmu}, std::cref(a())) },	// LD (nn), A
+		{}, // 0xeb
+		{}, // 0xec
+		{}, // 0xed
+		{ 0xee, std::bind(&BasicCPU::XOR,		this, std::cref(n)) },			// XOR A, n
+		{ 0xef, std::bind(&BasicCPU::RST<0x0028>,	this) },					// RST 0x0028 !!!
+
+		{ 0xf0, std::bind(&BasicCPU::LD<BYTE, OffsetRef<0xff00, Bus>>, this, std::ref(a()), OffsetRef<0xff00, Bus>{n, m_mmu}) }, // LD A, (N+0xff00)
+		{ 0xf1, std::bind(&BasicCPU::POP,		this, std::ref(m_state.af)) },			// POP AF
+		{ 0xf2, std::bind(&BasicCPU::LD<BYTE, OffsetRef<0xff00, Bus>>, this, std::ref(c()), OffsetRef<0xff00, Bus>{c(), m_mmu}) }, // LD A, (C+0xff00)
+		{ 0xf3, std::bind(&BasicCPU::DI,		this) },					// DI
+		{}, // 0xf4
+		{ 0xf5, std::bind(&BasicCPU::PUSH,		this, std::cref(m_state.af)) },			// PUSH AF
+		{ 0xf6, std::bind(&BasicCPU::OR,		this, std::cref(n)) },			// OR A, n
+		{}, // 0xf7
+		{ 0xf8, std::bind(&BasicCPU::LDadd,		this) },					// LD HL, SP+n
+		{}, // 0xf9
+		{ 0xfa, std::bind(&BasicCPU::LD<BYTE, MemRef<Bus>>, this, std::ref(a()), MemRef<Bus>{nn, m_mmu}) },	// LD A, (nn)
+		{ 0xfb, std::bind(&BasicCPU::EI,		this) },					// EI
+		{}, // 0xfc
+		{}, // 0xfd
+		{ 0xfe, std::bind(&BasicCPU::CP,		this, std::cref(n)) },			// CP A, n
+		{ 0xff, std::bind(&BasicCPU::RST<0x0038>,	this) },					// RST 0x0038 !!!
+	}};
+
+	if (m_engine == Engine::Jit && Jit::available()) {
+		auto offset = [this](const auto& member) {
+			return static_cast<const char*>(static_cast<const void*>(&member)) - static_cast<const char*>(static_cast<const void*>(this));
+		};
+		m_jit.reset(new Jit{{offset(m_state.af), offset(m_state.bc), offset(m_state.de), offset(m_state.hl), offset(m_state.sp), offset(m_state.pc), &BasicCPU::jitCallout, offset(m_counters.instructions)}});
+	}
+}
+
+// Handlers for the switch engine. Each one has the same effect as the
+// corresponding m_instructions entry; fetch, cycles and offset are handled by step().
+#define EXEC(op) template <typename Bus> void BasicCPU<Bus>::exec(Opcode<op>)
+#define EXEC_MISSING(op) EXEC(op) { \
+	std::cout << "Missing instruction: 0x" << std::hex << +op << '\n'; \
+	throw std::runtime_error{"Missing instruction"}; \
+}
+
+EXEC_MISSING(0x10) EXEC_MISSING(0xc4) EXEC_MISSING(0xc7) EXEC_MISSING(0xcc) EXEC_MISSING(0xd3) EXEC_MISSING(0xd4)
+EXEC_MISSING(0xd7) EXEC_MISSING(0xdb) EXEC_MISSING(0xdc) EXEC_MISSING(0xdd) EXEC_MISSING(0xe3) EXEC_MISSING(0xe4)
+EXEC_MISSING(0xe7) EXEC_MISSING(0xeb) EXEC_MISSING(0xec) EXEC_MISSING(0xed) EXEC_MISSING(0xf4) EXEC_MISSING(0xf7)
+EXEC_MISSING(0xf9) EXEC_MISSING(0xfc) EXEC_MISSING(0xfd)
+
+EXEC(0x00) {} // NOP
+EXEC(0x01) { LD(m_state.bc, nn); } // LD BC, nn
+EXEC(0x02) { MemRef<Bus> mem{m_state.bc, m_mmu}; LD(mem, a()); } // LD (BC), A
+EXEC(0x03) { INC(m_state.bc); } // INC BC
+EXEC(0x04) { INC(b()); } // INC B
+EXEC(0x05) { DEC(b()); } // DEC B
+EXEC(0x06) { LD(b(), n); } // LD B, n
+EXEC(0x07) { RLCA(); } // RLCA
+EXEC(0x08) { MemRef<Bus> mem{nn, m_mmu}; LD(mem, m_state.sp); } // LD (nn), SP
+EXEC(0x09) { ADD(m_state.hl, m_state.bc); } // ADD HL, BC
+EXEC(0x0a) { MemRef<Bus> mem{m_state.bc, m_mmu}; LD(a(), mem); } // LD A, (BC)
+EXEC(0x0b) { DEC(m_state.bc); } // DEC BC
+EXEC(0x0c) { INC(c()); } // INC C
+EXEC(0x0d) { DEC(c()); } // DEC C
+EXEC(0x0e) { LD(c(), n); } // LD C, n
+EXEC(0x0f) { RRCA(); } // RRCA
+
+EXEC(0x11) { LD(m_state.de, nn); } // LD DE, nn
+EXEC(0x12) { MemRef<Bus> mem{m_state.de, m_mmu}; LD(mem, a()); } // LD (DE), A
+EXEC(0x13) { INC(m_state.de); } // INC DE
+EXEC(0x14) { INC(d()); } // INC D
+EXEC(0x15) { DEC(d()); } // DEC D
+EXEC(0x16) { LD(d(), n); } // LD D, n
+EXEC(0x17) { RLA(); } // RLA
+EXEC(0x18) { JR(true, n); } // JR n
+EXEC(0x19) { ADD(m_state.hl, m_state.de); } // ADD HL, DE
+EXEC(0x1a) { MemRef<Bus> mem{m_state.de, m_mmu}; LD(a(), mem); } // LD A, (DE)
+EXEC(0x1b) { DEC(m_state.de); } // DEC DE
+EXEC(0x1c) { INC(e()); } // INC E
+EXEC(0x1d) { DEC(e()); } // DEC E
+EXEC(0x1e) { LD(e(), n); } // LD E, n
+EXEC(0x1f) { RRA(); } // RRA
+
+EXEC(0x20) { JRn(zeroFlag(), n); } // JR NZ, n
+EXEC(0x21) { LD(m_state.hl, nn); } // LD HL, nn
+EXEC(0x22) { MemRef<Bus> mem{m_state.hl, m_mmu}; LDI(mem, a()); } // LDI (HL+), A
+EXEC(0x23) { INC(m_state.hl); } // INC HL
+EXEC(0x24) { INC(h()); } // INC H
+EXEC(0x25) { DEC(h()); } // DEC H
+EXEC(0x26) { LD(h(), n); } // LD H, n
+EXEC(0x27) { DAA(); } // DAA
+EXEC(0x28) { JR(zeroFlag(), n); } // JR Z, n
+EXEC(0x29) { ADD(m_state.hl, m_state.hl); } // ADD HL, HL
+EXEC(0x2a) { MemRef<Bus> mem{m_state.hl, m_mmu}; LDI(a(), mem); } // LDI A, (HL+)
+EXEC(0x2b) { DEC(m_state.hl); } // DEC HL
+EXEC(0x2c) { INC(l()); } // INC L
+EXEC(0x2d) { DEC(l()); } // DEC L
+EXEC(0x2e) { LD(l(), n); } // LD L, n
+EXEC(0x2f) { CPL(); } // CPL
+
+EXEC(0x30) { JRn(carryFlag(), n); } // JR NC, n
+EXEC(0x31) { LD(m_state.sp, nn); } // LD SP, nn
+EXEC(0x32) { MemRef<Bus> mem{m_state.hl, m_mmu}; LDD(mem, a()); } // LDD (HL-), A
+EXEC(0x33) { INC(m_state.sp); } // INC SP
+EXEC(0x34) { INCmem(); } // INC (HL)
+EXEC(0x35) { DECmem(); } // DEC (HL)
+EXEC(0x36) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(mem, n); } // LD (HL), N
+EXEC(0x37) { SCF(); } // SCF
+EXEC(0x38) { JR(carryFlag(), n); } // JR C, n
+EXEC(0x39) { ADD(m_state.hl, m_state.sp); } // ADD HL, SP
+EXEC(0x3a) { MemRef<Bus> mem{m_state.hl, m_mmu}; LDD(a(), mem); } // LDD A, (HL-)
+EXEC(0x3b) { DEC(m_state.sp); } // DEC SP
+EXEC(0x3c) { INC(a()); } // INC A
+EXEC(0x3d) { DEC(a()); } // DEC A
+EXEC(0x3e) { LD(a(), n); } // LD A, n
+EXEC(0x3f) { CCF(); } // CCF
+
+EXEC(0x40) { LD(b(), b()); } // LD B, B
+EXEC(0x41) { LD(b(), c()); } // LD B, C
+EXEC(0x42) { LD(b(), d()); } // LD B, D
+EXEC(0x43) { LD(b(), e()); } // LD B, E
+EXEC(0x44) { LD(b(), h()); } // LD B, H
+EXEC(0x45) { LD(b(), l()); } // LD B, L
+EXEC(0x46) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(b(), mem); } // LD B, (HL)
+EXEC(0x47) { LD(b(), a()); } // LD B, A
+EXEC(0x48) { LD(c(), b()); } // LD C, B
+EXEC(0x49) { LD(c(), c()); } // LD C, C
+EXEC(0x4a) { LD(c(), d()); } // LD C, D
+EXEC(0x4b) { LD(c(), e()); } // LD C, E
+EXEC(0x4c) { LD(c(), h()); } // LD C, H
+EXEC(0x4d) { LD(c(), l()); } // LD C, L
+EXEC(0x4e) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(c(), mem); } // LD C, (HL)
+EXEC(0x4f) { LD(c(), a()); } // LD C, A
+
+EXEC(0x50) { LD(d(), b()); } // LD D, B
+EXEC(0x51) { LD(d(), c()); } // LD D, C
+EXEC(0x52) { LD(d(), d()); } // LD D, D
+EXEC(0x53) { LD(d(), e()); } // LD D, E
+EXEC(0x54) { LD(d(), h()); } // LD D, H
+EXEC(0x55) { LD(d(), l()); } // LD D, L
+EXEC(0x56) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(d(), mem); } // LD D, (HL)
+EXEC(0x57) { LD(d(), a()); } // LD D, A
+EXEC(0x58) { LD(e(), b()); } // LD E, B
+EXEC(0x59) { LD(e(), c()); } // LD E, C
+EXEC(0x5a) { LD(e(), d()); } // LD E, D
+EXEC(0x5b) { LD(e(), e()); } // LD E, E
+EXEC(0x5c) { LD(e(), h()); } // LD E, H
+EXEC(0x5d) { LD(e(), l()); } // LD E, L
+EXEC(0x5e) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(e(), mem); } // LD E, (HL)
+EXEC(0x5f) { LD(e(), a()); } // LD E, A
+
+EXEC(0x60) { LD(h(), b()); } // LD H, B
+EXEC(0x61) { LD(h(), c()); } // LD H, C
+EXEC(0x62) { LD(h(), d()); } // LD H, D
+EXEC(0x63) { LD(h(), e()); } // LD H, E
+EXEC(0x64) { LD(h(), h()); } // LD H, H
+EXEC(0x65) { LD(h(), l()); } // LD H, L
+EXEC(0x66) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(h(), mem); } // LD H, (HL)
+EXEC(0x67) { LD(h(), a()); } // LD H, A
+EXEC(0x68) { LD(l(), b()); } // LD L, B
+EXEC(0x69) { LD(l(), c()); } // LD L, C
+EXEC(0x6a) { LD(l(), d()); } // LD L, D
+EXEC(0x6b) { LD(l(), e()); } // LD L, E
+EXEC(0x6c) { LD(l(), h()); } // LD L, H
+EXEC(0x6d) { LD(l(), l()); } // LD L, L
+EXEC(0x6e) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(l(), mem); } // LD L, (HL)
+EXEC(0x6f) { LD(l(), a()); } // LD L, A
+
+EXEC(0x70) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(mem, b()); } // LD (HL), B
+EXEC(0x71) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(mem, c()); } // LD (HL), C
+EXEC(0x72) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(mem, d()); } // LD (HL), D
+EXEC(0x73) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(mem, e()); } // LD (HL), E
+EXEC(0x74) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(mem, h()); } // LD (HL), H
+EXEC(0x75) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(mem, l()); } // LD (HL), L
+EXEC(0x76) { HALT(); } // HALT
+EXEC(0x77) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(mem, a()); } // LD (HL), A
+EXEC(0x78) { LD(a(), b()); } // LD A, B
+EXEC(0x79) { LD(a(), c()); } // LD A, C
+EXEC(0x7a) { LD(a(), d()); } // LD A, D
+EXEC(0x7b) { LD(a(), e()); } // LD A, E
+EXEC(0x7c) { LD(a(), h()); } // LD A, H
+EXEC(0x7d) { LD(a(), l()); } // LD A, L
+EXEC(0x7e) { MemRef<Bus> mem{m_state.hl, m_mmu}; LD(a(), mem); } // LD A, (HL)
+EXEC(0x7f) { LD(a(), a()); } // LD A, A
+
+EXEC(0x80) { ADD(b()); } // ADD A, B
+EXEC(0x81) { ADD(c()); } // ADD A, C
+EXEC(0x82) { ADD(d()); } // ADD A, D
+EXEC(0x83) { ADD(e()); } // ADD A, E
+EXEC(0x84) { ADD(h()); } // ADD A, H
+EXEC(0x85) { ADD(l()); } // ADD A, L
+EXEC(0x86) { MemRef<Bus> mem{m_state.hl, m_mmu}; ADD(mem); } // ADD A, (HL)
+EXEC(0x87) { ADD(a()); } // ADD A, A
+EXEC(0x88) { ADC(b()); } // ADC A, B
+EXEC(0x89) { ADC(c()); } // ADC A, C
+EXEC(0x8a) { ADC(d()); } // ADC A, D
+EXEC(0x8b) { ADC(e()); } // ADC A, E
+EXEC(0x8c) { ADC(h()); } // ADC A, H
+EXEC(0x8d) { ADC(l()); } // ADC A, L
+EXEC(0x8e) { MemRef<Bus> mem{m_state.hl, m_mmu}; ADC(mem); } // ADC A, (HL)
+EXEC(0x8f) { ADC(a()); } // ADC A, A
+
+EXEC(0x90) { SUB(b()); } // SUB A, B
+EXEC(0x91) { SUB(c()); } // SUB A, C
+EXEC(0x92) { SUB(d()); } // SUB A, D
+EXEC(0x93) { SUB(e()); } // SUB A, E
+EXEC(0x94) { SUB(h()); } // SUB A, H
+EXEC(0x95) { SUB(l()); } // SUB A, L
+EXEC(0x96) { MemRef<Bus> mem{m_state.hl, m_mmu}; SUB(mem); } // SUB A, (HL)
+EXEC(0x97) { SUB(a()); } // SUB A, A
+EXEC(0x98) { SBC(b()); } // SBC A, B
+EXEC(0x99) { SBC(c()); } // SBC A, C
+EXEC(0x9a) { SBC(d()); } // SBC A, D
+EXEC(0x9b) { SBC(e()); } // SBC A, E
+EXEC(0x9c) { SBC(h()); } // SBC A, H
+EXEC(0x9d) { SBC(l()); } // SBC A, L
+EXEC(0x9e) { MemRef<Bus> mem{m_state.hl, m_mmu}; SBC(mem); } // SBC A, (HL)
+EXEC(0x9f) { SBC(a()); } // SBC A, A
+
+EXEC(0xa0) { AND(b()); } // AND A, B
+EXEC(0xa1) { AND(c()); } // AND A, C
+EXEC(0xa2) { AND(d()); } // AND A, D
+EXEC(0xa3) { AND(e()); } // AND A, E
+EXEC(0xa4) { AND(h()); } // AND A, H
+EXEC(0xa5) { AND(l()); } // AND A, L
+EXEC(0xa6) { MemRef<Bus> mem{m_state.hl, m_mmu}; AND(mem); } // AND A, (HL)
+EXEC(0xa7) { AND(a()); } // AND A, A
+EXEC(0xa8) { XOR(b()); } // XOR A, B
+EXEC(0xa9) { XOR(c()); } // XOR A, C
+EXEC(0xaa) { XOR(d()); } // XOR A, D
+EXEC(0xab) { XOR(e()); } // XOR A, E
+EXEC(0xac) { XOR(h()); } // XOR A, H
+EXEC(0xad) { XOR(l()); } // XOR A, L
+EXEC(0xae) { MemRef<Bus> mem{m_state.hl, m_mmu}; XOR(mem); } // XOR A, (HL)
+EXEC(0xaf) { XOR(a()); } // XOR A, A
+
+EXEC(0xb0) { OR(b()); } // OR A, B
+EXEC(0xb1) { OR(c()); } // OR A, C
+EXEC(0xb2) { OR(d()); } // OR A, D
+EXEC(0xb3) { OR(e()); } // OR A, E
+EXEC(0xb4) { OR(h()); } // OR A, H
+EXEC(0xb5) { OR(l()); } // OR A, L
+EXEC(0xb6) { MemRef<Bus> mem{m_state.hl, m_mmu}; OR(mem); } // OR A, (HL)
+EXEC(0xb7) { OR(a()); } // OR A, A
+EXEC(0xb8) { CP(b()); } // CP A, B
+EXEC(0xb9) { CP(c()); } // CP A, C
+EXEC(0xba) { CP(d()); } // CP A, D
+EXEC(0xbb) { CP(e()); } // CP A, E
+EXEC(0xbc) { CP(h()); } // CP A, H
+EXEC(0xbd) { CP(l()); } // CP A, L
+EXEC(0xbe) { MemRef<Bus> mem{m_state.hl, m_mmu}; CP(mem); } // CP A, (HL)
+EXEC(0xbf) { CP(a()); } // CP A, A
+
+EXEC(0xc0) { RETncond(zeroFlag()); } // RET NZ
+EXEC(0xc1) { POP(m_state.bc); } // POP BC
+EXEC(0xc2) { JPn(zeroFlag(), nn); } // JP NZ, nn
+EXEC(0xc3) { JP(true, nn); } // JP nn
+EXEC(0xc5) { PUSH(m_state.bc); } // PUSH BC
+EXEC(0xc6) { ADD(n); } // ADD A, n
+EXEC(0xc8) { RETcond(zeroFlag()); } // RET Z
+EXEC(0xc9) { RET(); } // RET
+EXEC(0xca) { JP(zeroFlag(), nn); } // JP Z, nn
+EXEC(0xcb) { CB(); } // CB
+EXEC(0xcd) { CALL(nn); } // CALL nn
+EXEC(0xce) { ADC(n); } // ADC A, n
+EXEC(0xcf) { RST<0x0008>(); } // RST 0x0008
+
+EXEC(0xd0) { RETncond(carryFlag()); } // RET NC
+EXEC(0xd1) { POP(m_state.de); } // POP DE
+EXEC(0xd2) { JPn(carryFlag(), nn); } // JP NC, nn
+EXEC(0xd5) { PUSH(m_state.de); } // PUSH DE
+EXEC(0xd6) { SUB(n); } // SUB A, n
+EXEC(0xd8) { RETcond(carryFlag()); } // RET C
+EXEC(0xd9) { RETI(); } // RETI
+EXEC(0xda) { JP(carryFlag(), nn); } // JP C, nn
+EXEC(0xde) { SBC(n); } // SBC A, n
+EXEC(0xdf) { RST<0x0018>(); } // RST 0x0018
+
+EXEC(0xe0) { OffsetRef<0xff00, Bus> io{n, m_mmu}; LD(io, a()); } // LD (N+0xff00), A
+EXEC(0xe1) { POP(m_state.hl); } // POP HL
+EXEC(0xe2) { OffsetRef<0xff00, Bus> io{c(), m_mmu}; LD(io, a()); } // LD (C+0xff00), A
+EXEC(0xe5) { PUSH(m_state.hl); } // PUSH HL
+EXEC(0xe6) { AND(n); } // AND A, n
+EXEC(0xe8) { ADD(); } // ADD SP, n
+EXEC(0xe9) { JP(true, m_state.hl); } // JP HL
+EXEC(0xea) { MemRef<Bus> mem{nn, m_mmu}; LD(mem, a()); } // LD (nn), A
+EXEC(0xee) { XOR(n); } // XOR A, n
+EXEC(0xef) { RST<0x0028>(); } // RST 0x0028
+
+EXEC(0xf0) { OffsetRef<0xff00, Bus> io{n, m_mmu}; LD(a(), io); } // LD A, (N+0xff00)
+EXEC(0xf1) { POP(m_state.af); } // POP AF
+EXEC(0xf2) { OffsetRef<0xff00, Bus> io{c(), m_mmu}; LD(c(), io); } // LD A, (C+0xff00)
+EXEC(0xf3) { DI(); } // DI
+EXEC(0xf5) { PUSH(m_state.af); } // PUSH AF
+EXEC(0xf6) { OR(n); } // OR A, n
+EXEC(0xf8) { LDadd(); } // LD HL, SP+n
+EXEC(0xfa) { MemRef<Bus> mem{nn, m_mmu}; LD(a(), mem); } // LD A, (nn)
+EXEC(0xfb) { EI(); } // EI
+EXEC(0xfe) { CP(n); } // CP A, n
+EXEC(0xff) { RST<0x0038>(); } // RST 0x0038
+
+#undef EXEC_MISSING
+#undef EXEC
+
+#define EXEC_CASE(op) case op: exec<op>(); break;
+
+template <typename Bus>
+void BasicCPU<Bus>::execute(BYTE opcode) {
+	switch (opcode) {
+		OPCODE_TABLE(EXEC_CASE)
+	}
+}
+
+#undef EXEC_CASE
+
+// Threaded dispatch: every handler fetches the next opcode and jumps to its handler itself,
+// so each opcode gets its own indirect branch. Build with -DGB_NO_COMPUTED_GOTO (or with a
+// compiler lacking labels-as-values) to get the same loop as a plain switch.
+#if defined(__GNUC__) && !defined(GB_NO_COMPUTED_GOTO)
+#define GB_COMPUTED_GOTO
+#endif
+
+#define THREADED_FETCH() \
+	handleInterrupts(); \
+	opcode = m_mmu.readByte(m_state.pc++); \
+	prepareFlags(opcode); \
+	m_state.cycles = 0;
+
+// the handlers know the length of their opcode, so only the bytes actually used are read
+#define THREADED_OPERANDS(op) \
+	if (OPCODES[op].length == 2) { \
+		n = m_mmu.readByte(m_state.pc); \
+	} else if (OPCODES[op].length == 3) { \
+		nn = readWord(m_state.pc); \
+	}
+
+#define THREADED_RETIRE(op) \
+	GB_COUNT(m_counters.instructions++); \
+	if (fixedCycles(OPCODES[op]) != 0) { \
+		m_state.cycles = fixedCycles(OPCODES[op]); \
+	} \
+	m_state.pc += operandBytes(OPCODES[op]); \
+	total += m_state.cycles; \
+	if ((op & 0xe7) == 0x20 && m_idleSkipping && m_state.cycles == 12 && total < budget) { \
+		total += skipIdleLoop(total, budget - total); \
+	} \
+	if (total >= budget || (op == 0x76 && m_state.halted)) { \
+		return total; \
+	}
+
+#ifdef GB_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wgnu-label-as-value"
+#endif
+
+#define THREADED_LABEL(op) &&handler_##op,
+#define THREADED_HANDLER(op) \
+	handler_##op: \
+	THREADED_OPERANDS(op) \
+	exec<op>(); \
+	THREADED_RETIRE(op) \
+	THREADED_FETCH() \
+	goto *labels[opcode];
+
+template <typename Bus>
+DWORD BasicCPU<Bus>::runThreaded(DWORD budget) {
+	static const void* const labels[256] = { OPCODE_TABLE(THREADED_LABEL) };
+	DWORD total = 0;
+	BYTE opcode;
+
+	THREADED_FETCH()
+	goto *labels[opcode];
+
+	OPCODE_TABLE(THREADED_HANDLER)
+}
+
+#undef THREADED_HANDLER
+#undef THREADED_LABEL
+#pragma GCC diagnostic pop
+#else
+
+#define THREADED_CASE(op) \
+	case op: \
+		THREADED_OPERANDS(op) \
+		exec<op>(); \
+		THREADED_RETIRE(op) \
+		break;
+
+template <typename Bus>
+DWORD BasicCPU<Bus>::runThreaded(DWORD budget) {
+	DWORD total = 0;
+	BYTE opcode;
+
+	for (;;) {
+		THREADED_FETCH()
+		switch (opcode) {
+			OPCODE_TABLE(THREADED_CASE)
+		}
+	}
+}
+
+#undef THREADED_CASE
+#endif
+
+#undef THREADED_RETIRE
+#undef THREADED_OPERANDS
+#undef THREADED_FETCH
+
+// The cached engine's per-instruction work, with the handler, length and cycles known at compile time.
+template <typename Bus>
+template <BYTE opcode>
+typename BasicCPU<Bus>::Next BasicCPU<Bus>::execCached(const BlockCache::Op& op, DWORD& total, DWORD budget) {
+	m_state.pc++;
+	if (OPCODES[opcode].length == 2) {
+		n = op.n;
+	} else if (OPCODES[opcode].length == 3) {
+		nn = op.nn;
+	}
+	m_state.cycles = 0;
+	prepareFlags(opcode);
+	exec<opcode>();
+	GB_COUNT(m_counters.instructions++);
+	if (fixedCycles(OPCODES[opcode]) != 0) {
+		m_state.cycles = fixedCycles(OPCODES[opcode]);
+	}
+	m_state.pc += operandBytes(OPCODES[opcode]);
+	total += m_state.cycles;
+	if ((opcode & 0xe7) == 0x20 && m_idleSkipping && m_state.cycles == 12 && total < budget) {
+		total += skipIdleLoop(total, budget - total);
+	}
+
+	if (total >= budget) {
+		return Next::RETURN;
+	}
+	if (m_mmu.codeChanged() || (m_state.ime && m_intState.pending() != 0)) {
+		return Next::LEAVE_BLOCK;
+	}
+	return Next::CONTINUE;
+}
+
+template <typename Bus>
+template <BYTE first, BYTE second>
+typename BasicCPU<Bus>::Next BasicCPU<Bus>::execFused(const BlockCache::Op* ops, DWORD& total, DWORD budget) {
+	Next next = execCached<first>(ops[0], total, budget);
+	if (next != Next::CONTINUE) {
+		return next;
+	}
+	return execCached<second>(ops[1], total, budget);
+}
+
+#define SUPERINSTRUCTION_ID(first, second) SUPER_##first##_##second,
+#define SUPERINSTRUCTION_PAIR(first, second) {{ first, second }},
+#define SUPERINSTRUCTION_CASE(first, second) case SUPER_##first##_##second: return execFused<first, second>(ops, total, budget);
+
+namespace {
+enum Superinstruction : BYTE { SUPER_NONE, SUPERINSTRUCTIONS(SUPERINSTRUCTION_ID) SUPER_COUNT };
+const std::array<std::array<BYTE, 2>, SUPER_COUNT> SUPERINSTRUCTION_PAIRS{{ {{ 0, 0 }}, SUPERINSTRUCTIONS(SUPERINSTRUCTION_PAIR) }};
+}
+
+// Runs ops[0] and ops[1], which decodeBlock() found in SUPERINSTRUCTIONS.
+template <typename Bus>
+typename BasicCPU<Bus>::Next BasicCPU<Bus>::execSuperinstruction(const BlockCache::Op* ops, DWORD& total, DWORD budget) {
+	switch (ops[0].fused) {
+	SUPERINSTRUCTIONS(SUPERINSTRUCTION_CASE)
+	default:
+		throw std::runtime_error{"Unknown superinstruction"};
+	}
+}
+
+#undef SUPERINSTRUCTION_CASE
+#undef SUPERINSTRUCTION_PAIR
+#undef SUPERINSTRUCTION_ID
+
+template <typename Bus>
+DWORD BasicCPU<Bus>::step() {
+	if (m_state.halted) {
+		if (m_intState.pending() == 0) {
+			m_state.cycles = 4;
+			if (m_trace) {
+				m_trace->elapse(m_state.cycles);
+			}
+			return m_state.cycles;
+		}
+		m_state.halted = false;
+	}
+	if (m_stepping && (m_stopRequested || m_breakpoints.has(m_mmu.codeBank(m_state.pc), m_state.pc))) {
+		stop();
+	}
+	WORD pc = m_state.pc;
+	WORD sp = m_state.sp;
+	auto rb = m_mmu.readByte(m_state.pc++);
+	m_stepOpcode = rb;
+	auto& op = m_instructions[rb];
+	const auto& info = OPCODES[rb];
+	if (info.length == 2) {
+		n = m_mmu.readByte(m_state.pc);
+	} else if (info.length == 3) {
+		nn = readWord(m_state.pc);
+	}
+	// a missing instruction is the last one in the trace
+	if (m_trace) {
+		traceInstruction(pc, rb);
+	}
+	if (op.opcode != rb) {
+		std::cout << "Missing instruction: 0x" << std::hex << +rb << " (0x" << std::hex << +op.opcode << ")\n";
+		throw std::runtime_error{"Missing instruction"};
+	}
+	if (m_pairs) {
+		(*m_pairs)[static_cast<std::size_t>(m_lastOpcode << 8 | rb)]++;
+		m_lastOpcode = rb;
+	}
+
+	prepareFlags(rb);
+
+	if (m_debugMode) {
+		materializeFlags();
+		std::cout << "PC: 0x" << std::setfill('0') << std::setw(4) << std::hex << +(m_state.pc-1) << '\n';
+		std::cout << "SP: 0x" << std::setfill('0') << std::setw(4) << std::hex << +m_state.sp << '\n';
+		std::cout << "AF: 0x" << std::setfill('0') << std::setw(4) << std::hex << +m_state.af << " == 0b" << std::bitset<16>(m_state.af) << " = [f: " << std::bitset<8>(f()) << "][a: " << std::bitset<8>(a()) << "]\n";
+		std::cout << "BC: 0x" << std::setfill('0') << std::setw(4) << std::hex << +m_state.bc << " == 0b" << std::bitset<16>(m_state.bc) << " = [c: " << std::bitset<8>(c()) << "][b: " << std::bitset<8>(b()) << "]\n";
+		std::cout << "DE: 0x" << std::setfill('0') << std::setw(4) << std::hex << +m_state.de << " == 0b" << std::bitset<16>(m_state.de) << " = [e: " << std::bitset<8>(e()) << "][d: " << std::bitset<8>(d()) << "]\n";
+		std::cout << "HL: 0x" << std::setfill('0') << std::setw(4) << std::hex << +m_state.hl << " == 0b" << std::bitset<16>(m_state.hl) << " = [l: " << std::bitset<8>(l()) << "][h: " << std::bitset<8>(h()) << "]\n";
+		std::cout << "Instruction: 0x" << std::hex << +rb << " = " << disassemble(rb, n, nn);
+		std::cout << "\n----\n\n";
+		std::cin.get();
+	}
+	m_state.cycles = 0;
+	if (m_engine == Engine::Table) {
+		op.f();
+	} else {
+		execute(rb);
+	}
+	GB_COUNT(m_counters.instructions++);
+	// note: some instructions have variable length cycles. these instructions have fixedCycles() == 0 and set the correct values themselves.
+	if (fixedCycles(info) != 0) {
+		m_state.cycles = fixedCycles(info);
+	}
+	m_state.pc += operandBytes(info);
+
+	if (m_trace) {
+		m_trace->elapse(m_state.cycles);
+	}
+	if (m_profiler) {
+		m_profiler->instruction(profilerLocation(pc), m_state.cycles);
+		// taken calls push the return address, taken returns pop it
+		if (info.flow == Flow::CALL && m_state.sp == static_cast<WORD>(sp - 2)) {
+			m_profiler->call(profilerLocation(m_state.pc), pc, static_cast<WORD>(pc + info.length));
+		} else if (info.flow == Flow::RETURN && m_state.sp == static_cast<WORD>(sp + 2)) {
+			m_profiler->ret(m_state.pc);
+		}
+	}
+	return m_state.cycles;
+}
+
+template <typename Bus>
+DWORD BasicCPU<Bus>::run(DWORD budget) {
+	DWORD total = 0;
+	while (total < budget) {
+		if (m_state.halted) {
+			if (m_intState.pending() == 0) {
+				// nothing can wake the CPU before the end of the budget
+				if (m_trace) {
+					m_trace->elapse(budget - total);
+				}
+				return budget;
+			}
+			m_state.halted = false;
+		}
+		if (m_stepping) {
+			handleInterrupts();
+			total += step();
+			continue;
+		}
+		switch (m_engine) {
+		case Engine::Threaded:
+			total += runThreaded(budget - total);
+			break;
+		case Engine::Cached:
+		case Engine::Jit:
+			total += runCached(budget - total);
+			break;
+		default:
+			handleInterrupts();
+			if (m_idleSkipping) {
+				total += step();
+				// a halted step() leaves the opcode as it was, but takes 4 cycles
+				if ((m_stepOpcode & 0xe7) == 0x20 && m_state.cycles == 12 && total < budget) {
+					total += skipIdleLoop(total, budget - total);
+				}
+			} else {
+				total += step();
+			}
+			break;
+		}
+	}
+	return total;
+}
+
+// Code is only decoded ahead of time from memory that can be read without side effects.
+static bool cacheable(WORD addr) {
+	return addr <= 0x7fff || (0xc000 <= addr && addr <= 0xdfff) || (0xff80 <= addr && addr <= 0xfffe);
+}
+
+template <typename Bus>
+BlockCache::Block* BasicCPU<Bus>::decodeBlock(WORD start) {
+	static const std::size_t MAX_OPS = 64;
+
+	BlockCache::Block block{};
+	WORD addr = start;
+	WORD last = start;
+	while (block.ops.size() < MAX_OPS) {
+		if (!cacheable(addr)) {
+			break;
+		}
+		// the rest of the ROM is data, unless the map doesn't know the start either (e.g. after JP HL);
+		// maps are discovered with bank 1 mapped
+		if (m_codeMap && m_mmu.codeBank(addr) <= 1 && addr != start && addr >= 0x100 && m_codeMap->code(start) && !m_codeMap->code(addr)) {
+			break;
+		}
+		BYTE opcode = m_mmu.readByte(addr);
+		const auto& info = OPCODES[opcode];
+		if (m_instructions[opcode].opcode != opcode) {
+			// left to step(), which reports it
+			break;
+		}
+		// the operands are read like step() does, so they have to be cacheable as well
+		if (!cacheable(static_cast<WORD>(addr + info.length - 1))) {
+			break;
+		}
+
+		BlockCache::Op op{};
+		op.opcode = opcode;
+		if (info.length == 2) {
+			op.n = m_mmu.readByte(static_cast<WORD>(addr + 1));
+		} else if (info.length == 3) {
+			op.nn = readWord(static_cast<WORD>(addr + 1));
+		}
+		op.cycles = fixedCycles(info);
+		op.offset = operandBytes(info);
+		block.ops.push_back(op);
+
+		last = static_cast<WORD>(addr + info.length - 1);
+		addr = static_cast<WORD>(addr + info.length);
+		// HALT ends a block so run() can fast-forward
+		if (info.flow != Flow::NONE || opcode == 0x76) {
+			break;
+		}
+	}
+	if (block.ops.empty()) {
+		return nullptr;
+	}
+	if (m_superinstructions) {
+		for (std::size_t i = 0; i + 1 < block.ops.size(); i++) {
+			std::array<BYTE, 2> pair{{ block.ops[i].opcode, block.ops[i + 1].opcode }};
+			auto found = std::find(SUPERINSTRUCTION_PAIRS.begin() + 1, SUPERINSTRUCTION_PAIRS.end(), pair);
+			if (found != SUPERINSTRUCTION_PAIRS.end()) {
+				block.ops[i].fused = static_cast<BYTE>(found - SUPERINSTRUCTION_PAIRS.begin());
+				i++;
+			}
+		}
+	}
+
+	block.aot = aotCode(start);
+
+	BYTE firstPage = static_cast<BYTE>(start >> 8);
+	BYTE lastPage = static_cast<BYTE>(last >> 8);
+	for (int page = firstPage; page <= lastPage; page++) {
+		m_mmu.watchCodePage(static_cast<BYTE>(page));
+	}
+	return &m_blockCache.insert(m_mmu.codeBank(start), start, firstPage, lastPage, std::move(block));
+}
+
+template <typename Bus>
+DWORD BasicCPU<Bus>::runCached(DWORD budget) {
+	DWORD total = 0;
+	for (;;) {
+		if (m_mmu.codeChanged()) {
+			auto pages = m_mmu.takeChangedCodePages();
+			for (std::size_t page = 0; page < pages.size(); page++) {
+				if (pages[page]) {
+					m_blockCache.invalidatePage(static_cast<BYTE>(page));
+				}
+			}
+		}
+		handleInterrupts();
+		if (m_state.halted) {
+			return total;
+		}
+
+		BlockCache::Block* block = m_blockCache.find(m_mmu.codeBank(m_state.pc), m_state.pc);
+		if (block == nullptr) {
+			block = decodeBlock(m_state.pc);
+		}
+		if (block == nullptr) {
+			total += step();
+			if (total >= budget) {
+				return total;
+			}
+			continue;
+		}
+
+		if (block->aot != nullptr) {
+			// checks the budget and leaves like the loop below, after every instruction
+			total += block->aot(this, budget - total);
+			if (total >= budget) {
+				return total;
+			}
+			continue;
+		}
+
+		if (m_jit && block->code == nullptr && ++block->executions == Jit::HOT) {
+			block->code = m_jit->compile(m_state.pc, *block);
+			if (block->code == nullptr) {
+				// out of code space, start over
+				m_jit->flush();
+				m_blockCache.clear();
+				continue;
+			}
+		}
+		if (block->code != nullptr) {
+			materializeFlags();
+			total += block->code(this, budget - total);
+			if (m_jitError) {
+				auto error = m_jitError;
+				m_jitError = nullptr;
+				std::rethrow_exception(error);
+			}
+			// m_cycles is the last callout's, skipIdleLoop() checks it was the JR
+			if (m_idleSkipping && (block->ops.back().opcode & 0xe7) == 0x20 && m_state.cycles == 12 && total < budget) {
+				total += skipIdleLoop(total, budget - total);
+			}
+			if (total >= budget) {
+				return total;
+			}
+			continue;
+		}
+
+		const auto& ops = block->ops;
+		for (std::size_t i = 0; i < ops.size(); i++) {
+			const auto& op = ops[i];
+			if (op.fused != 0) {
+				Next next = execSuperinstruction(&op, total, budget);
+				if (next == Next::RETURN) {
+					return total;
+				} else if (next == Next::LEAVE_BLOCK) {
+					break;
+				}
+				i++;
+				continue;
+			}
+
+			m_state.pc++;
+			n = op.n;
+			nn = op.nn;
+			m_state.cycles = 0;
+			prepareFlags(op.opcode);
+			execute(op.opcode);
+			GB_COUNT(m_counters.instructions++);
+			if (op.cycles != 0) {
+				m_state.cycles = op.cycles;
+			}
+			m_state.pc += op.offset;
+			total += m_state.cycles;
+			if (m_idleSkipping && (op.opcode & 0xe7) == 0x20 && m_state.cycles == 12 && total < budget) {
+				total += skipIdleLoop(total, budget - total);
+			}
+
+			if (total >= budget) {
+				return total;
+			}
+			// the rest of the block may be stale, or an interrupt has to be taken first
+			if (m_mmu.codeChanged() || (m_state.ime && m_intState.pending() != 0)) {
+				break;
+			}
+		}
+	}
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setSuperinstructions(bool fuse) {
+	m_superinstructions = fuse;
+	// blocks are fused when decoded
+	m_blockCache.clear();
+	if (m_jit) {
+		m_jit->flush();
+	}
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setAot(const AotProgram* program) {
+	if (!std::is_same<Bus, MMU>::value) {
+		throw std::runtime_error{"Translated code runs on BasicCPU<MMU> only"};
+	}
+	m_aot.clear();
+	if (program != nullptr) {
+		for (std::size_t i = 0; i < program->count; i++) {
+			const AotBlock& block = program->blocks[i];
+			m_aot[static_cast<DWORD>(block.bank << 16 | block.addr)] = &block;
+		}
+	}
+	// blocks get their functions when decoded
+	m_blockCache.clear();
+	if (m_jit) {
+		m_jit->flush();
+	}
+}
+
+// The function translated from the bytes at the address, if they are still there (they aren't
+// while the boot ROM is mapped, or with a different ROM or bank).
+template <typename Bus>
+auto BasicCPU<Bus>::aotCode(WORD start) -> decltype(BlockCache::Block::aot) {
+	auto it = m_aot.find(static_cast<DWORD>(m_mmu.codeBank(start) << 16 | start));
+	if (it == m_aot.end()) {
+		return nullptr;
+	}
+	const AotBlock& block = *it->second;
+	for (BYTE i = 0; i < block.length; i++) {
+		if (m_mmu.readByte(static_cast<WORD>(start + i)) != block.bytes[i]) {
+			return nullptr;
+		}
+	}
+	return block.code;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setProfiling(bool profile) {
+	if (!profile) {
+		m_profiler.reset();
+	} else if (!m_profiler) {
+		m_profiler.reset(new Profiler{profilerLocation(m_state.pc)});
+	}
+	updateStepping();
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setCodeMap(const CodeMap& map) {
+	m_codeMap.reset(new CodeMap{map});
+	if (m_engine != Engine::Cached && m_engine != Engine::Jit) {
+		return;
+	}
+	for (WORD start : m_codeMap->blocks()) {
+		if (m_blockCache.find(m_mmu.codeBank(start), start) == nullptr) {
+			decodeBlock(start);
+		}
+	}
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setTracing(std::size_t entries) {
+	if (entries == 0) {
+		m_trace.reset();
+	} else {
+		m_trace.reset(new Trace{entries});
+	}
+	updateStepping();
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setBreakpoint(WORD addr, bool on) {
+	m_breakpoints.set(addr, on);
+	updateStepping();
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setBankBreakpoint(BYTE bank, WORD addr, bool on) {
+	m_breakpoints.setInBank(bank, addr, on);
+	updateStepping();
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setDebugger(Debugger* debugger) {
+	m_debugger = debugger;
+	m_stopRequested = (debugger != nullptr);
+	updateStepping();
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::requestStop() {
+	m_stopRequested = true;
+	updateStepping();
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::updateStepping() {
+	m_stepping = m_debugMode || m_debugger || m_stopRequested || !m_breakpoints.empty() || m_pairs || m_profiler || m_trace;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::stop() {
+	m_stopRequested = false;
+	if (m_debugger == nullptr) {
+		m_debugMode = true;
+		return;
+	}
+	materializeFlags();
+	m_stopRequested = m_debugger->stopped(m_state, m_breakpoints);
+	updateStepping();
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::traceInstruction(WORD pc, BYTE opcode) {
+	materializeFlags();
+	TraceEntry entry{};
+	entry.pc = pc;
+	entry.af = m_state.af;
+	entry.bc = m_state.bc;
+	entry.de = m_state.de;
+	entry.hl = m_state.hl;
+	entry.sp = m_state.sp;
+	entry.opcode = opcode;
+	if (OPCODES[opcode].length == 2) {
+		entry.operands[0] = n;
+	} else if (OPCODES[opcode].length == 3) {
+		entry.operands[0] = static_cast<BYTE>(nn);
+		entry.operands[1] = static_cast<BYTE>(nn >> 8);
+	}
+	m_trace->record(entry);
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setPairProfiling(bool profile) {
+	if (!profile) {
+		m_pairs.reset();
+	} else if (!m_pairs) {
+		m_pairs.reset(new std::array<uint64_t, 0x10000>{});
+	}
+	updateStepping();
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::writeSuperinstructions(std::ostream& out, std::size_t count) const {
+	std::vector<std::size_t> pairs;
+	if (m_pairs) {
+		for (std::size_t pair = 0; pair < m_pairs->size(); pair++) {
+			const auto& first = OPCODES[pair >> 8];
+			// only pairs decodeBlock() can put into one block
+			bool fusable = first.flow == Flow::NONE && (pair >> 8) != 0x76 && (pair >> 8) != 0x10;
+			if ((*m_pairs)[pair] != 0 && fusable) {
+				pairs.push_back(pair);
+			}
+		}
+	}
+	std::sort(pairs.begin(), pairs.end(), [this](std::size_t lhs, std::size_t rhs) {
+		return (*m_pairs)[lhs] > (*m_pairs)[rhs];
+	});
+	pairs.resize(std::min(pairs.size(), count));
+
+	out << "#pragma once\n\n";
+	out << "// Generated by `gb <rom> <breakpoint> --profile-pairs` (CPU::writeSuperinstructions()): the most\n";
+	out << "// frequent pairs of opcodes, which the cached engine runs with a single dispatch.\n";
+	out << "#define SUPERINSTRUCTIONS(X)";
+	for (auto pair : pairs) {
+		out << " \\\n\tX(0x" << std::hex << std::setfill('0') << std::setw(2) << (pair >> 8)
+			<< ", 0x" << std::setw(2) << (pair & 0xff) << ") /* " << OPCODES[pair >> 8].mnemonic << "; "
+			<< OPCODES[pair & 0xff].mnemonic << ": " << std::dec << (*m_pairs)[pair] << " */";
+	}
+	out << '\n';
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setIdleSkipping(bool skip) {
+	m_idleSkipping = skip;
+}
+
+// An idle loop loads A from memory, tests it with CP n, AND n or BIT b, A and branches back with
+// JR cc. It stores nothing, and nothing else writes memory or requests interrupts during a run()
+// budget (the GPU is updated between budgets), so every iteration after the first one ends in the
+// same state and takes the same number of cycles. Whole iterations are skipped, the last one
+// (which the budget ends in) is executed as usual. elapsed are the cycles run since the GPU
+// was last updated, at least.
+template <typename Bus>
+DWORD BasicCPU<Bus>::skipIdleLoop(DWORD elapsed, DWORD remaining) {
+	// the JR just taken
+	WORD jr = static_cast<WORD>(m_state.pc - 2 - static_cast<int8_t>(n));
+	if (jr == m_busyLoop) {
+		return 0;
+	}
+	DWORD cycles = idleLoopCycles(jr);
+	if (cycles == 0) {
+		// remembered, so loops doing real work don't pay for decoding every iteration
+		m_busyLoop = jr;
+		return 0;
+	}
+	if (elapsed < cycles) {
+		// the last iteration may have loaded A before the GPU was updated
+		return 0;
+	}
+
+	DWORD skipped = (remaining - 1) / cycles * cycles;
+	m_skippedCycles += skipped;
+	return skipped;
+}
+
+template <typename Bus>
+DWORD BasicCPU<Bus>::idleLoopCycles(WORD jr) {
+	static const int MAX_TESTS = 3;
+
+	if (static_cast<int8_t>(n) >= 0 || (m_mmu.readByte(jr) & 0xe7) != 0x20 || m_mmu.readByte(static_cast<WORD>(jr + 1)) != n) {
+		return 0;
+	}
+
+	WORD addr = m_state.pc;
+	BYTE load = m_mmu.readByte(addr);
+	if (load != 0xf0 && load != 0xfa) {
+		// LDH A, (n) or LD A, (nn)
+		return 0;
+	}
+	DWORD cycles = OPCODES[load].cycles;
+	addr = static_cast<WORD>(addr + OPCODES[load].length);
+
+	for (int i = 0; i < MAX_TESTS && addr != jr; i++) {
+		BYTE opcode = m_mmu.readByte(addr);
+		if (opcode == 0xfe || opcode == 0xe6) {
+			// CP n, AND n
+			cycles += OPCODES[opcode].cycles;
+			addr = static_cast<WORD>(addr + 2);
+		} else if (opcode == 0xcb && (m_mmu.readByte(static_cast<WORD>(addr + 1)) & 0xc7) == 0x47) {
+			// BIT b, A
+			cycles += CB_OPCODES[0x47].cycles;
+			addr = static_cast<WORD>(addr + 2);
+		} else {
+			return 0;
+		}
+	}
+	if (addr != jr) {
+		return 0;
+	}
+	return cycles + OPCODES[0x20].takenCycles;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::setLazyFlags(bool lazy) {
+	materializeFlags();
+	m_lazyFlags = lazy;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::materializeFlags() {
+	// Z, N, H and C are assembled in one go instead of through the BitRefs
+	const LazyFlags& p = m_pending;
+	BYTE flags = (static_cast<BYTE>(p.result) == 0) ? 0x80 : 0x00;
+	switch (p.op) {
+	case LazyFlags::NONE:
+		return;
+	case LazyFlags::ADD:
+		flags |= (((p.lhs & 0xf) + (p.rhs & 0xf) + p.carry) > 0xf) ? 0x20 : 0x00;
+		flags |= (p.result > 0xff) ? 0x10 : 0x00;
+		break;
+	case LazyFlags::SUB:
+		flags |= 0x40;
+		flags |= ((p.lhs & 0xf) < (p.rhs & 0xf) + p.carry) ? 0x20 : 0x00;
+		flags |= (p.result < 0) ? 0x10 : 0x00;
+		break;
+	case LazyFlags::AND:
+		flags |= 0x20;
+		break;
+	case LazyFlags::OR:
+		break;
+	case LazyFlags::INC:
+		flags |= ((p.lhs & 0xf) == 0xf) ? 0x20 : 0x00;
+		flags |= static_cast<BYTE>(p.carry << 4);
+		break;
+	case LazyFlags::DEC:
+		flags |= 0x40;
+		flags |= ((p.lhs & 0xf) == 0) ? 0x20 : 0x00;
+		flags |= static_cast<BYTE>(p.carry << 4);
+		break;
+	}
+	f() = static_cast<BYTE>((f() & 0x0f) | flags);
+	m_pending.op = LazyFlags::NONE;
+}
+
+// Runs one instruction of a translated block, see jit.cpp for the arguments.
+template <typename Bus>
+DWORD BasicCPU<Bus>::jitCallout(void* self, DWORD op, DWORD operands) {
+	auto cpu = static_cast<BasicCPU*>(self);
+	try {
+		cpu->m_state.pc = static_cast<WORD>((operands >> 16) + 1);
+		cpu->n = static_cast<BYTE>(op >> 24);
+		cpu->nn = static_cast<WORD>(operands);
+		cpu->m_state.cycles = 0;
+		cpu->prepareFlags(static_cast<BYTE>(op));
+		cpu->execute(static_cast<BYTE>(op));
+		GB_COUNT(cpu->m_counters.instructions++);
+		// translated code reads f directly
+		cpu->materializeFlags();
+		BYTE cycles = static_cast<BYTE>(op >> 8);
+		if (cycles != 0) {
+			cpu->m_state.cycles = cycles;
+		}
+		cpu->m_state.pc += static_cast<BYTE>(op >> 16);
+	} catch (...) {
+		cpu->m_jitError = std::current_exception();
+		return Jit::EXIT;
+	}
+
+	bool exit = cpu->m_mmu.codeChanged() ||
+		(cpu->m_state.ime && cpu->m_intState.pending() != 0);
+	return cpu->m_state.cycles | (exit ? Jit::EXIT : 0);
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::dispatchInterrupt() {
+	GB_COUNT(m_counters.interrupts++);
+	switch (m_intState.next()) {
+	case InterruptState::VBLANK:
+		RST_INT<0x0040, InterruptState::VBLANK>();
+		break;
+	case InterruptState::LCD_STAT:
+		RST_INT<0x0048, InterruptState::LCD_STAT>();
+		break;
+	case InterruptState::TIMER:
+		RST_INT<0x0050, InterruptState::TIMER>();
+		break;
+	case InterruptState::SERIAL:
+		RST_INT<0x0058, InterruptState::SERIAL>();
+		break;
+	case InterruptState::JOYPAD:
+		RST_INT<0x0060, InterruptState::JOYPAD>();
+		break;
+	}
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::JR(const bool& cond, const BYTE& offset) {
+	if (cond) {
+		m_state.pc += static_cast<int8_t>(offset);
+		m_state.cycles += 4;
+	}
+	m_state.pc += 1;
+	m_state.cycles += 8;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::JRn(const bool& cond, const BYTE& offset) {
+	if (!cond) {
+		m_state.pc += static_cast<int8_t>(offset);
+		m_state.cycles += 4;
+	}
+	m_state.pc += 1;
+	m_state.cycles += 8;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::JP(const bool& cond, const WORD& addr) {
+	if (cond) {
+		m_state.pc = addr;
+		m_state.cycles += 4;
+	} else {
+		m_state.pc += 2;
+	}
+	m_state.cycles += 12;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::JPn(const bool& cond, const WORD& addr) {
+	if (!cond) {
+		m_state.pc = addr;
+		m_state.cycles += 4;
+	} else {
+		m_state.pc += 2;
+	}
+	m_state.cycles += 12;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::ADD(const BYTE& source) {
+	if (m_lazyFlags) {
+		BYTE lhs = a();
+		BYTE rhs = source;
+		a() = static_cast<BYTE>(lhs + rhs);
+		m_pending = {LazyFlags::ADD, lhs, rhs, 0, lhs + rhs};
+		return;
+	}
+#ifdef GB_ALU_TABLES
+	setAF(addTable(a(), source, false));
+#else
+	halfFlag() = ((((a() & 0xf) + (source & 0xf)) & 0xf0) != 0);
+	WORD temp = static_cast<WORD>(a()) + static_cast<WORD>(source);
+	a() = static_cast<BYTE>(temp);
+	carryFlag() = ((temp & 0xf00) != 0);
+	zeroFlag() = (a() == 0);
+	negFlag() = false;
+#endif
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::ADC(const BYTE& source) {
+	if (m_lazyFlags) {
+		BYTE lhs = a();
+		BYTE rhs = source;
+		BYTE carry = carryFlag();
+		a() = static_cast<BYTE>(lhs + rhs + carry);
+		m_pending = {LazyFlags::ADD, lhs, rhs, carry, lhs + rhs + carry};
+		return;
+	}
+#ifdef GB_ALU_TABLES
+	setAF(addTable(a(), source, carryFlag()));
+#else
+	halfFlag() = ((((a() & 0xf) + (source & 0xf) + carryFlag()) & 0xf0) != 0);
+	WORD temp = static_cast<WORD>(a()) + static_cast<WORD>(source) + carryFlag();
+	a() = static_cast<BYTE>(temp);
+	carryFlag() = ((temp & 0xf00) != 0);
+	zeroFlag() = (a() == 0);
+	negFlag() = false;
+#endif
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::SUB(const BYTE& source) {
+	if (m_lazyFlags) {
+		BYTE lhs = a();
+		BYTE rhs = source;
+		a() = static_cast<BYTE>(lhs - rhs);
+		m_pending = {LazyFlags::SUB, lhs, rhs, 0, lhs - rhs};
+		return;
+	}
+#ifdef GB_ALU_TABLES
+	setAF(subTable(a(), source, false));
+#else
+	halfFlag() = ((a() & 0xf) < (source & 0xf));
+	int temp = a() - source;
+	a() = static_cast<BYTE>(temp);
+	zeroFlag() = (a() == 0);
+	carryFlag() = (temp < 0);
+	negFlag() = true;
+#endif
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::SBC(const BYTE& source) {
+	if (m_lazyFlags) {
+		BYTE lhs = a();
+		BYTE rhs = source;
+		BYTE carry = carryFlag();
+		a() = static_cast<BYTE>(lhs - rhs - carry);
+		m_pending = {LazyFlags::SUB, lhs, rhs, carry, lhs - rhs - carry};
+		return;
+	}
+#ifdef GB_ALU_TABLES
+	setAF(subTable(a(), source, carryFlag()));
+#else
+	halfFlag() = ((a() & 0xf) < ((source & 0xf) + carryFlag()));
+	int temp = a() - source - carryFlag();
+	a() = static_cast<BYTE>(temp);
+	zeroFlag() = (a() == 0);
+	carryFlag() = (temp < 0);
+	negFlag() = true;
+#endif
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::AND(const BYTE& source) {
+	if (m_lazyFlags) {
+		a() &= source;
+		m_pending = {LazyFlags::AND, 0, 0, 0, a()};
+		return;
+	}
+	a() &= source;
+	zeroFlag() = (a() == 0);
+	halfFlag() = true;
+	negFlag() = false;
+	carryFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::XOR(const BYTE& source) {
+	if (m_lazyFlags) {
+		a() ^= source;
+		m_pending = {LazyFlags::OR, 0, 0, 0, a()};
+		return;
+	}
+	a() ^= source;
+	zeroFlag() = (a() == 0);
+	halfFlag() = false;
+	negFlag() = false;
+	carryFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::OR(const BYTE& source) {
+	if (m_lazyFlags) {
+		a() |= source;
+		m_pending = {LazyFlags::OR, 0, 0, 0, a()};
+		return;
+	}
+	a() |= source;
+	zeroFlag() = (a() == 0);
+	halfFlag() = false;
+	negFlag() = false;
+	carryFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::CP(const BYTE& source) {
+	if (m_lazyFlags) {
+		m_pending = {LazyFlags::SUB, a(), source, 0, a() - source};
+		return;
+	}
+#ifdef GB_ALU_TABLES
+	f() = static_cast<BYTE>(subTable(a(), source, false) | (f() & 0x0f));
+#else
+	int temp = a() - source;
+	halfFlag() = ((a() & 0xf) < (source & 0xf));
+	carryFlag() = (temp < 0);
+	negFlag() = true;
+	zeroFlag() = (temp == 0);
+#endif
+}
+
+template <typename Bus>
+const std::array<typename BasicCPU<Bus>::CBHandler, 256> BasicCPU<Bus>::s_cbHandlers =
+	BasicCPU<Bus>::cbHandlers(std::make_index_sequence<256>{});
+
+template <typename Bus>
+void BasicCPU<Bus>::CB() {
+	(this->*s_cbHandlers[n])();
+	m_state.cycles += CB_OPCODES[n].cycles;
+}
+
+// Bits 6-7 of a CB opcode select a rotate or shift (by bits 3-5), BIT, RES or SET (of the bit in
+// bits 3-5); bits 0-2 the operand. (HL) is read once and, unless tested by BIT, written once.
+template <typename Bus>
+template <BYTE opcode>
+void BasicCPU<Bus>::execCB() {
+	if ((opcode & 0x07) == 6) {
+		BYTE value = m_mmu.readByte(m_state.hl);
+		execCB<opcode>(value);
+		if ((opcode & 0xc0) != 0x40) {
+			m_mmu.writeByte(m_state.hl, value);
+		}
+	} else {
+		execCB<opcode>(cbRegister(opcode & 0x07));
+	}
+}
+
+template <typename Bus>
+template <BYTE opcode>
+void BasicCPU<Bus>::execCB(BYTE& target) {
+	const int bit = (opcode >> 3) & 0x07;
+	switch (opcode >> 6) {
+	case 0:
+		switch (bit) {
+		case 0: RLC(target); break;
+		case 1: RRC(target); break;
+		case 2: RL(target); break;
+		case 3: RR(target); break;
+		case 4: SLA(target); break;
+		case 5: SRA(target); break;
+		case 6: SWAP(target); break;
+		default: SRL(target); break;
+		}
+		break;
+	case 1: {
+		BitRef<BYTE, bit> ref{target};
+		BIT(ref);
+		break;
+	}
+	case 2: {
+		BitRef<BYTE, bit> ref{target};
+		RES(ref);
+		break;
+	}
+	default: {
+		BitRef<BYTE, bit> ref{target};
+		SET(ref);
+		break;
+	}
+	}
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::RLCA() {
+	// slightly different than RLC: m_zeroFlag is always false
+	carryFlag() = ((a() >> 7) != 0);
+	a() = static_cast<BYTE>((a() << 1) | carryFlag());
+	zeroFlag() = false;
+	halfFlag() = false;
+	negFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::RRCA() {
+	// slightly different than RRC: m_zeroFlag is always false
+	carryFlag() = ((a() & 0x1) != 0);
+	a() = static_cast<BYTE>((a() >> 1) | (carryFlag() << 7));
+	zeroFlag() = false;
+	halfFlag() = false;
+	negFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::RLA() {
+	// slightly different than RL: m_zeroFlag is always false
+	bool temp = carryFlag();
+	carryFlag() = ((a() & 0b10000000) != 0);
+	a() = static_cast<BYTE>((a() << 1) | temp);
+	zeroFlag() = false;
+	halfFlag() = false;
+	negFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::RRA() {
+	// slightly different than RR: m_zeroFlag is always false
+	bool temp = carryFlag();
+	carryFlag() = ((a() & 0x1) != 0);
+	a() = static_cast<BYTE>((a() >> 1) | (temp << 7));
+	zeroFlag() = false;
+	halfFlag() = false;
+	negFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::ADD(WORD& target, const WORD& source) {
+	int temp = target + source;
+	carryFlag() = (temp > 0xffff);
+	negFlag() = false;
+	halfFlag() = ((((target & 0x0fff) + (source & 0x0fff)) & 0xf000) != 0);
+	target = static_cast<WORD>(temp);
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::ADD() {
+	// see: http://forums.nesdev.com/viewtopic.php?p=42143#p42143
+	zeroFlag() = false;
+	negFlag() = false;
+	halfFlag() = ((((m_state.sp & 0xf) + (n & 0xf)) & 0xf0) != 0);
+	carryFlag() = ((((m_state.sp & 0xff) + n) & 0xf00) != 0);
+	m_state.sp = static_cast<WORD>(m_state.sp + static_cast<char>(n));
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::LDadd() {
+	// see: http://forums.nesdev.com/viewtopic.php?p=42143#p42143
+	zeroFlag() = false;
+	negFlag() = false;
+	halfFlag() = ((((m_state.sp & 0xf) + (n & 0xf)) & 0xf0) != 0);
+	carryFlag() = ((((m_state.sp & 0xff) + n) & 0xf00) != 0);
+	m_state.hl = static_cast<WORD>(m_state.sp + static_cast<char>(n));
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::CCF() {
+	carryFlag() = !carryFlag();
+	negFlag() = false;
+	halfFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::SCF() {
+	carryFlag() = true;
+	negFlag() = false;
+	halfFlag() = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::CPL() {
+	a() ^= 0xff;
+	negFlag() = true;
+	halfFlag() = true;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::DAA() {
+#ifdef GB_ALU_TABLES
+	setAF(daaTable(a(), f()));
+#else
+	// see: http://www.worldofspectrum.org/faq/reference/z80reference.htm#DAA
+	//BYTE oldA = a;
+	int temp = a();
+	BYTE correction = 0x00;
+
+	if (a() > 0x99 || carryFlag()) {
+		correction |= 0x60;
+		carryFlag() = true;
+	}
+	//nop:
+	//else {
+	//	correction |= 0x00;
+	//	m_carryFlag = false;
+	//}
+	
+	if ((a() & 0x0f) > 0x9 || halfFlag()) {
+		correction |= 0x06;
+	}
+	// nop:
+	// else {
+	// 	correction |= 0x00;
+	// }
+	
+	temp = (negFlag()) ? (temp-correction) : (temp+correction);
+
+	// m_halfFlag is always false in gameboy cpu
+	// m_halfFlag = (((oldA ^ a) & 0b0001000) != 0);
+	halfFlag() = false;
+	a() = static_cast<BYTE>(temp);
+	zeroFlag() = (a() == 0);
+#endif
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::CALL(const WORD& addr) {
+	WORD newpc = m_state.pc + 2;
+	m_mmu.writeByte(m_state.sp-1, newpc >> 8);
+	m_mmu.writeByte(m_state.sp-2, newpc & 0xff);
+	m_state.sp -= 2;
+	m_state.pc = addr;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::POP(WORD& reg) {
+	reg = static_cast<WORD>(m_mmu.readByte(m_state.sp) + (m_mmu.readByte(m_state.sp+1) << 8));
+	m_state.sp += 2;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::PUSH(const WORD& reg) {
+	m_mmu.writeByte(m_state.sp-1, static_cast<BYTE>(reg >> 8));
+	m_mmu.writeByte(m_state.sp-2, static_cast<BYTE>(reg));
+	m_state.sp -= 2;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::EI() {
+	m_state.ime = true;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::DI() {
+	m_state.ime = false;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::HALT() {
+	m_state.halted = true;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::RET() {
+	BYTE low = m_mmu.readByte(m_state.sp);
+	BYTE high = m_mmu.readByte(m_state.sp+1);
+	m_state.pc = static_cast<WORD>((high << 8) + low);
+	m_state.sp += 2;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::RETcond(const bool& cond) {
+	if (cond) {
+		RET();
+		m_state.cycles += 12;
+	}
+	m_state.cycles += 8;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::RETncond(const bool& cond) {
+	if (!cond) {
+		RET();
+		m_state.cycles += 12;
+	}
+	m_state.cycles += 8;
+}
+
+template <typename Bus>
+void BasicCPU<Bus>::RETI() {
+	m_state.ime = true;
+	RET();
+}
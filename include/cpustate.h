@@ -0,0 +1,29 @@
+#pragma once
+
+#include <type_traits>
+
+#include "types.h"
+
+// Everything an instruction can change besides memory, in one cache line. Trivially copyable,
+// so snapshots and restores are a single memcpy (see CPU::snapshot()).
+struct alignas(64) CPUState {
+	// A and F, B and C, ... (the high byte is the first register)
+	WORD af = 0;
+	WORD bc = 0;
+	WORD de = 0;
+	WORD hl = 0;
+	WORD sp = 0;
+	WORD pc = 0;
+
+	// Interrupt Master Enable
+	bool ime = false;
+	// HALT: no instructions run until an enabled interrupt is requested
+	bool halted = false;
+
+	// number of cycles of the last instruction
+	DWORD cycles = 0;
+};
+
+static_assert(std::is_trivially_copyable<CPUState>::value, "CPUState is copied with memcpy");
+static_assert(std::is_standard_layout<CPUState>::value, "the JIT addresses CPUState members by offset");
+static_assert(sizeof(CPUState) == 64, "CPUState should fill one cache line");
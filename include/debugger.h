@@ -0,0 +1,63 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <unordered_map>
+
+#include "types.h"
+#include "cpustate.h"
+
+// One bit per address, so checking for a breakpoint costs the same however many there are.
+// Breakpoints in one ROM bank (see IMMU::codeBank()) have a bit of their own, their banks are only
+// looked up at addresses that have one.
+class Breakpoints {
+	public:
+		bool has(BYTE bank, WORD addr) const {
+			if (m_bits[addr]) {
+				return true;
+			}
+			if (!m_bankedBits[addr]) {
+				return false;
+			}
+			auto it = m_banks.find(addr);
+			return it != m_banks.end() && it->second[bank];
+		}
+		// in every bank
+		void set(WORD addr, bool on = true) {
+			if (m_bits[addr] != on) {
+				m_bits[addr] = on;
+				m_count = on ? m_count + 1 : m_count - 1;
+			}
+		}
+		// only while the bank is mapped
+		void setInBank(BYTE bank, WORD addr, bool on = true) {
+			auto& banks = m_banks[addr];
+			if (banks[bank] != on) {
+				banks[bank] = on;
+				m_count = on ? m_count + 1 : m_count - 1;
+			}
+			m_bankedBits[addr] = banks.any();
+			if (banks.none()) {
+				m_banks.erase(addr);
+			}
+		}
+		bool empty() const {
+			return m_count == 0;
+		}
+	private:
+		std::bitset<0x10000> m_bits;
+		std::bitset<0x10000> m_bankedBits;
+		std::unordered_map<WORD, std::bitset<256>> m_banks;
+		std::size_t m_count = 0;
+};
+
+// Takes over when the CPU stops at a breakpoint, after a single step or on request, see
+// CPU::setDebugger().
+class Debugger {
+	public:
+		virtual ~Debugger() = default;
+
+		// Called before the instruction at state.pc runs, flags up to date. The registers and the
+		// breakpoints may be changed; returns true to stop again before the next instruction.
+		virtual bool stopped(CPUState&, Breakpoints&) = 0;
+};
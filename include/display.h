@@ -1,15 +1,14 @@
 #pragma once
 
-#include <array>
-#include <cstdint>
 #include <SDL2/SDL.h>
 
-class Display {
+#include "idisplay.h"
+
+class Display : public IDisplay {
 	public:
-		using PixelArray = std::array<uint32_t, 160 * 144>;
 		Display();
-		void render(PixelArray&);
-		~Display();
+		virtual void render(PixelArray&) override;
+		virtual ~Display();
 	private:
 		SDL_Window* m_window = nullptr;
 		SDL_Renderer* m_renderer = nullptr;
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+
+#include "types.h"
+#include "mapper.h"
+#include "idisplay.h"
+#include "interruptstate.h"
+#include "gpu.h"
+#include "mmu.h"
+#include "cpu.h"
+#include "timedbus.h"
+#include "scheduler.h"
+#include "counters.h"
+
+// The whole machine. The CPU runs in batches that end at the next GPU event (mode change or
+// scanline), so the GPU and the interrupt controller are only updated between batches. In the
+// M-cycle accurate mode a second CPU steps through a TimedBus instead, which ticks the GPU
+// before every memory access. In the scheduled mode the CPU and the GPU are tasks of a Scheduler
+// with their own clocks, the GPU only wakes up for its events.
+class Emulator {
+	public:
+		struct Summary {
+			DWORD cycles = 0;
+			// VBlanks entered
+			DWORD frames = 0;
+			// batches, i.e. how often the CPU stopped to update the GPU
+			DWORD syncs = 0;
+			// cycles passed in skipped idle loops, see CPU::setIdleSkipping()
+			DWORD skipped = 0;
+		};
+
+		Emulator(std::unique_ptr<Mapper>&&, IDisplay&, CPU::Engine = CPU::Engine::Switch);
+
+		// runs until at least the given number of cycles has passed
+		Summary runFor(DWORD);
+		// runs until the next VBlank
+		Summary runFrame();
+
+		// the instruction-level CPU, its settings (engine, profiling, ...) don't apply to the accurate mode
+		BasicCPU<MMU>& cpu() {
+			return m_cpu;
+		}
+
+		// switches between the modes at the next instruction, the registers carry over
+		void setCycleAccurate(bool);
+		bool cycleAccurate() const {
+			return m_cycleAccurate;
+		}
+		// switches between the batch loop and the scheduler, the GPU's progress carries over; the
+		// accurate mode and the scheduled mode exclude each other, enabling one leaves the other
+		void setScheduled(bool);
+		bool scheduled() const {
+			return m_scheduled;
+		}
+		// registers of the CPU of the current mode
+		CPUState snapshot();
+		void restore(const CPUState&);
+
+		GPU& gpu() {
+			return m_gpu;
+		}
+
+		MMU& mmu() {
+			return m_mmu;
+		}
+
+		// the counters of all components since the start, all 0 in builds without counters
+		Counters counters() const;
+	private:
+		InterruptState m_intState;
+		GPU m_gpu;
+		MMU m_mmu;
+		// memory accesses are devirtualized, see BasicCPU
+		BasicCPU<MMU> m_cpu;
+
+		TimedBus m_timedBus;
+		CPU m_accurateCpu;
+		bool m_cycleAccurate = false;
+
+		Scheduler m_scheduler;
+		GpuTask m_gpuTask;
+		CpuTask<BasicCPU<MMU>> m_cpuTask;
+		bool m_scheduled = false;
+
+		// the cycles, the components count the rest
+		Counters m_counters;
+
+		// executes one batch and brings the GPU up to date
+		void sync(Summary&, DWORD);
+		// one interrupt dispatch and instruction in the accurate mode, returns the cycles that passed
+		DWORD stepAccurate();
+		// resumes the tasks until the cycles have passed or, with frame set, the next VBlank
+		Summary runScheduled(DWORD, bool frame);
+};
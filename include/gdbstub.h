@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+
+#include "types.h"
+#include "immu.h"
+#include "debugger.h"
+
+// A GDB remote serial protocol server on a loopback TCP port, for `target remote localhost:<port>`.
+// Registers are sent in the order of GDB's z80 target (AF, BC, DE, HL, SP, PC, 16 bits each),
+// memory is read and written through the MMU, breakpoints are software breakpoints (Z0 and Z1).
+class GdbStub : public Debugger {
+	public:
+		// waits for GDB to connect, throws std::runtime_error if the port can't be opened
+		GdbStub(IMMU&, WORD port);
+		~GdbStub() override;
+		GdbStub(const GdbStub&) = delete;
+		GdbStub& operator=(const GdbStub&) = delete;
+
+		bool stopped(CPUState&, Breakpoints&) override;
+
+		// true if GDB asked to stop the running program (Ctrl-C), doesn't block
+		bool interrupted();
+		// false once GDB has detached or disconnected
+		bool attached() const {
+			return m_fd >= 0;
+		}
+	private:
+		IMMU& m_mmu;
+		int m_fd = -1;
+		// set while the program runs, a stop has to be reported when it stops again
+		bool m_running = false;
+
+		// reads the next packet's data, false if the connection was closed
+		bool receive(std::string&);
+		void send(const std::string&);
+		void detach();
+
+		// what to do after a packet
+		enum class Action { REPLY, CONTINUE, STEP, DETACH };
+		Action handle(const std::string&, CPUState&, Breakpoints&, std::string& reply);
+};
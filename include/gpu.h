@@ -3,13 +3,27 @@
 #include <array>
 #include "types.h"
 #include "bitref.h"
-#include "display.h"
+#include "idisplay.h"
 #include "interruptstate.h"
+#include "counters.h"
 
 class GPU {
 	public:
-		GPU(Display&, InterruptState&);
+		GPU(IDisplay&, InterruptState&);
 		void step(DWORD);
+		// cycles until the next mode change, the CPU may run this long without updating the GPU
+		DWORD cyclesUntilEvent() const;
+		// For callers that keep the GPU's time themselves (see Scheduler): ends the current mode
+		// as if its remaining cycles had passed, returns the length of the next one.
+		DWORD advance();
+		// number of VBlanks so far
+		DWORD frames() const {
+			return m_frames;
+		}
+		// mode changes and frames
+		const Counters& counters() const {
+			return m_counters;
+		}
 		void writeByte(WORD, BYTE);
 		BYTE readByte(WORD);
 
@@ -36,9 +50,13 @@ class GPU {
 		static const int WIDTH = 160;
 		static const int HEIGHT = 144;
 		std::array<DWORD, WIDTH * HEIGHT> m_pixelArray;
-		Display& m_display;
+		IDisplay& m_display;
 		InterruptState& m_intState;
 
+		DWORD endMode();
+		void setMode(BYTE);
+		void setLY(BYTE);
+
 		void renderScanline();
 		void renderTiles();
 		void renderSprites();
@@ -47,6 +65,10 @@ class GPU {
 		void updateAttributes(WORD, BYTE);
 
 		DWORD m_cycleCount = 0;
+		// of the current mode, the LCD starts in HBlank
+		DWORD m_modeLength = 204;
+		DWORD m_frames = 0;
+		Counters m_counters;
 
 		std::array<BYTE, 0x2000> m_vram;
 		std::array<BYTE, 0xa0> m_oam;
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+class IDisplay {
+	public:
+		using PixelArray = std::array<uint32_t, 160 * 144>;
+		virtual void render(PixelArray&) = 0;
+		virtual ~IDisplay() = default;
+};
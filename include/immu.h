@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <array>
+#include <bitset>
 
 #include "mapper.h"
 #include "types.h"
@@ -14,4 +15,50 @@ class IMMU {
 
 		WORD readWord(WORD);
 		void writeWord(WORD, WORD);
+
+		// The CPU watches the 256 byte pages it has decoded code from. Changes to a watched
+		// page are collected until the CPU drops the affected decoded code.
+		void watchCodePage(BYTE);
+		bool codeChanged() const {
+			return m_codeChanged;
+		}
+		std::bitset<256> takeChangedCodePages();
+
+		// The mapper's ROM bank (see Mapper::romBank()) as of the last write to it. Code is cached
+		// by (codeBank(), address): a bank switch doesn't drop anything, the other bank's code is
+		// found again once it is switched back in.
+		BYTE romBank() const {
+			return m_romBank;
+		}
+		DWORD bankGeneration() const {
+			return m_bankGeneration;
+		}
+		// the switchable bank at 0x4000-0x7fff, 0 for the rest of the address space
+		BYTE codeBank(WORD addr) const {
+			return (addr >= 0x4000 && addr <= 0x7fff) ? m_romBank : 0;
+		}
+	protected:
+		// to be called by implementations whenever the byte at the address may have changed
+		void changed(WORD addr) {
+			if (m_watchedPages[addr >> 8]) {
+				m_watchedPages[addr >> 8] = false;
+				m_changedPages[addr >> 8] = true;
+				m_codeChanged = true;
+			}
+		}
+		// to be called by implementations after a write to the mapper; a switch counts as a code
+		// change without changed pages, so running code leaves a block decoded from the old bank
+		void bankWritten(BYTE bank, DWORD generation) {
+			if (generation != m_bankGeneration) {
+				m_romBank = bank;
+				m_bankGeneration = generation;
+				m_codeChanged = true;
+			}
+		}
+	private:
+		std::bitset<256> m_watchedPages;
+		std::bitset<256> m_changedPages;
+		bool m_codeChanged = false;
+		BYTE m_romBank = 1;
+		DWORD m_bankGeneration = 0;
 };
@@ -1,13 +1,10 @@
 #pragma once
 
-#include <string>
 #include <functional>
 #include "types.h"
 
+// length, cycles and mnemonic of the opcodes are in opcodes.h
 struct Instruction {
 	BYTE opcode = 0;
 	std::function<void(void)> f;
-	std::string description;
-	BYTE cycles = 0;
-	BYTE offset = 0;
 };
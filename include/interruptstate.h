@@ -1,25 +1,63 @@
 #pragma once
 
 #include "types.h"
-#include "bitref.h"
 
-struct InterruptState {
-	// Interrupt Master Enable
-	bool ime = false;
+// IF and IE. pending() is kept up to date on every change, so the CPU checks a single byte before
+// taking the slow path that dispatches an interrupt.
+class InterruptState {
+	public:
+		// bits of IF and IE, the lowest has the highest priority
+		enum Source : BYTE {
+			VBLANK = 0x01,
+			LCD_STAT = 0x02,
+			TIMER = 0x04,
+			SERIAL = 0x08,
+			JOYPAD = 0x10,
+		};
 
-	// Interrupt Flag (0xff0f)
-	BYTE intFlag = 0;
-	BitRef<BYTE, 0> vBlankReq{intFlag};
-	BitRef<BYTE, 1> lcdStatReq{intFlag};
-	BitRef<BYTE, 2> timerReq{intFlag};
-	BitRef<BYTE, 3> serialReq{intFlag};
-	BitRef<BYTE, 4> joypadReq{intFlag};
+		// Interrupt Flag (0xff0f)
+		BYTE intFlag() const {
+			return m_intFlag;
+		}
+		void setIntFlag(BYTE v) {
+			m_intFlag = v;
+			update();
+		}
 
-	// Interrupt Enable (0xffff)
-	BYTE intEnable = 0;
-	BitRef<BYTE, 0> vBlank{intEnable};
-	BitRef<BYTE, 1> lcdStat{intEnable};
-	BitRef<BYTE, 2> timer{intEnable};
-	BitRef<BYTE, 3> serial{intEnable};
-	BitRef<BYTE, 4> joypad{intEnable};
+		// Interrupt Enable (0xffff)
+		BYTE intEnable() const {
+			return m_intEnable;
+		}
+		void setIntEnable(BYTE v) {
+			m_intEnable = v;
+			update();
+		}
+
+		// called by the peripherals
+		void request(Source source) {
+			m_intFlag |= source;
+			update();
+		}
+		// called when the interrupt is dispatched
+		void acknowledge(Source source) {
+			m_intFlag &= static_cast<BYTE>(~source);
+			update();
+		}
+
+		// the requested and enabled interrupts, dispatched while IME is set
+		BYTE pending() const {
+			return m_pending;
+		}
+		// the pending interrupt with the highest priority, pending() must not be 0
+		Source next() const {
+			return static_cast<Source>(m_pending & -m_pending);
+		}
+	private:
+		BYTE m_intFlag = 0;
+		BYTE m_intEnable = 0;
+		BYTE m_pending = 0;
+
+		void update() {
+			m_pending = m_intFlag & m_intEnable & 0x1f;
+		}
 };
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "types.h"
+#include "blockcache.h"
+
+// Translates decoded blocks into x86-64 machine code. AF, BC, DE, HL and SP are held in host
+// registers while a block runs; register-only instructions are translated directly, everything
+// else (memory, I/O, control flow, ...) calls back into the interpreter.
+class Jit {
+	public:
+		// runs a translated block until it ends or the given budget is used up, returns the cycles taken
+		using Code = decltype(BlockCache::Block::code);
+		// executes one instruction in the interpreter, arguments and result are described in jit.cpp
+		using Callout = DWORD (*)(void*, DWORD, DWORD);
+
+		// set in the result of a callout when the translated block has to return
+		static const DWORD EXIT = 0x80000000;
+		// blocks are translated after this many executions
+		static const DWORD HOT = 8;
+
+		// where the registers live relative to the CPU
+		struct Layout {
+			std::ptrdiff_t af, bc, de, hl, sp, pc;
+			Callout callout;
+			// the 64-bit count of retired instructions, incremented by translated code in builds with counters
+			std::ptrdiff_t instructions;
+		};
+
+		// false if the host can't run translated code, compile() always fails then
+		static bool available();
+
+		explicit Jit(const Layout&);
+		~Jit();
+		Jit(const Jit&) = delete;
+		Jit& operator=(const Jit&) = delete;
+
+		// returns nullptr if the code buffer is full, flush() and try again
+		Code compile(WORD, const BlockCache::Block&);
+		// drops all translated code
+		void flush();
+	private:
+		Layout m_layout;
+		BYTE* m_buffer = nullptr;
+		std::size_t m_used = 0;
+};
@@ -12,8 +12,28 @@ class Mapper {
 		virtual BYTE readByte(WORD) = 0;
 		virtual void writeByte(WORD, BYTE) = 0;
 
+		// the ROM bank mapped at 0x4000-0x7fff, and a counter bumped on every switch, so whoever
+		// caches code read from there can tell that it has to look at the bank again
+		BYTE romBank() const {
+			return m_romBank;
+		}
+		DWORD bankGeneration() const {
+			return m_bankGeneration;
+		}
+
 		static std::unique_ptr<Mapper> fromFile(const std::string&);
 	protected:
 		Mapper(std::vector<BYTE>&&);
 		std::vector<BYTE> m_rom;
+
+		// to be called by mappers with a bank controller
+		void switchBank(BYTE bank) {
+			if (bank != m_romBank) {
+				m_romBank = bank;
+				m_bankGeneration++;
+			}
+		}
+	private:
+		BYTE m_romBank = 1;
+		DWORD m_bankGeneration = 0;
 };
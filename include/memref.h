@@ -3,19 +3,29 @@
 #include "types.h"
 #include "immu.h"
 
+template <typename Bus>
 class MemRef {
 	public:
-		MemRef(const WORD&, IMMU&);
+		MemRef(const WORD& addr, Bus& mmu) : m_addr{addr}, m_mmu{mmu} {}
 
 		MemRef(const MemRef&) = default;
 		MemRef& operator=(const MemRef&) = delete;
 		virtual ~MemRef() = default;
 
-		operator BYTE () const;
+		operator BYTE () const {
+			return m_mmu.readByte(m_addr);
+		}
 
-		void operator=(BYTE);
-		void operator=(WORD);
+		void operator=(BYTE rhs) {
+			m_mmu.writeByte(m_addr, rhs);
+		}
+
+		// two writes through the Bus (IMMU::writeWord() is out of line)
+		void operator=(WORD rhs) {
+			m_mmu.writeByte(m_addr, static_cast<BYTE>(rhs));
+			m_mmu.writeByte(static_cast<WORD>(m_addr + 1), static_cast<BYTE>(rhs >> 8));
+		}
 	private:
 		const WORD& m_addr;
-		IMMU& m_mmu;
+		Bus& m_mmu;
 };
@@ -8,15 +8,60 @@
 #include "types.h"
 #include "gpu.h"
 #include "interruptstate.h"
+#include "counters.h"
 
-class MMU : public IMMU {
+// final, so BasicCPU<MMU> calls readByte()/writeByte() directly: work RAM, high RAM and the
+// cartridge are accessed inline, everything else through readOther()/writeOther(). Every access
+// is counted by region in builds with counters (see Counters).
+class MMU final : public IMMU {
 	public:
 		MMU(std::unique_ptr<Mapper>&&, GPU&, InterruptState&);
 
-		virtual BYTE readByte(WORD) override;
-		virtual void writeByte(WORD, BYTE) override;
+		virtual BYTE readByte(WORD addr) override {
+			if (0xc000 <= addr && addr <= 0xcfff) {
+				GB_COUNT(m_counters.reads[Counters::WRAM]++);
+				return wram0[addr - 0xc000];
+			} else if (0xd000 <= addr && addr <= 0xdfff) {
+				GB_COUNT(m_counters.reads[Counters::WRAM]++);
+				return wram1[addr - 0xd000];
+			} else if (0xff80 <= addr && addr <= 0xfffe) {
+				GB_COUNT(m_counters.reads[Counters::HRAM]++);
+				return hram[addr - 0xff80];
+			} else if (addr <= 0x7fff && !(biosMode && addr < 0x100)) {
+				GB_COUNT(m_counters.reads[Counters::ROM]++);
+				return mapper->readByte(addr);
+			}
+			return readOther(addr);
+		}
+
+		virtual void writeByte(WORD addr, BYTE v) override {
+			if (0xc000 <= addr && addr <= 0xcfff) {
+				GB_COUNT(m_counters.writes[Counters::WRAM]++);
+				wram0[addr - 0xc000] = v;
+				changed(addr);
+			} else if (0xd000 <= addr && addr <= 0xdfff) {
+				GB_COUNT(m_counters.writes[Counters::WRAM]++);
+				wram1[addr - 0xd000] = v;
+				changed(addr);
+			} else if (0xff80 <= addr && addr <= 0xfffe) {
+				GB_COUNT(m_counters.writes[Counters::HRAM]++);
+				hram[addr - 0xff80] = v;
+				changed(addr);
+			} else {
+				writeOther(addr, v);
+			}
+		}
+
+		// accesses by region and DMA transfers
+		const Counters& counters() const {
+			return m_counters;
+		}
 
 	private:
+		// the whole address space
+		BYTE readOther(WORD);
+		void writeOther(WORD, BYTE);
+
 		// ROM/BIOS: 0x0000 to 0x7fff
 		std::unique_ptr<Mapper> mapper;
 		static std::array<BYTE, 256> bios;
@@ -30,4 +75,6 @@ class MMU : public IMMU {
 
 		std::array<BYTE, 4096> wram0 = {{ 0 }};
 		std::array<BYTE, 4096> wram1 = {{ 0 }};
+
+		Counters m_counters;
 };
@@ -3,10 +3,10 @@
 #include "types.h"
 #include "immu.h"
 
-template <WORD offset>
+template <WORD offset, typename Bus>
 class OffsetRef {
 	public:
-		OffsetRef(const BYTE& addr, IMMU& mmu) : m_addr{addr}, m_mmu{mmu} {}
+		OffsetRef(const BYTE& addr, Bus& mmu) : m_addr{addr}, m_mmu{mmu} {}
 
 		OffsetRef(const OffsetRef&) = default;
 		OffsetRef& operator=(const OffsetRef&) = delete;
@@ -21,5 +21,5 @@ class OffsetRef {
 		}
 	private:
 		const BYTE& m_addr;
-		IMMU& m_mmu;
+		Bus& m_mmu;
 };
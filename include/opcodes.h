@@ -0,0 +1,605 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "types.h"
+
+// masks of the flags in F
+constexpr BYTE FLAG_Z = 0x80;
+constexpr BYTE FLAG_N = 0x40;
+constexpr BYTE FLAG_H = 0x20;
+constexpr BYTE FLAG_C = 0x10;
+constexpr BYTE FLAGS_ALL = FLAG_Z | FLAG_N | FLAG_H | FLAG_C;
+
+// how an instruction affects the program counter
+enum class Flow : BYTE { NONE, JUMP, CALL, RETURN };
+
+// Static description of an opcode, shared by the interpreter, the disassembly and the tests.
+struct OpcodeInfo {
+	// nullptr for opcodes that don't exist
+	const char* mnemonic;
+	// including the opcode (and the 0xcb prefix)
+	BYTE length;
+	// conditional branches: when not taken. 0 for 0xcb, see CB_OPCODES
+	BYTE cycles;
+	// conditional branches: when taken, 0 otherwise
+	BYTE takenCycles;
+	BYTE flagsRead;
+	BYTE flagsWritten;
+	Flow flow;
+};
+
+// cycles step() charges, 0 if the handler counts them (conditional branches, 0xcb)
+constexpr BYTE fixedCycles(const OpcodeInfo& info) {
+	return (info.takenCycles == 0) ? info.cycles : 0;
+}
+
+// bytes step() skips after the handler, branches move the PC themselves
+constexpr BYTE operandBytes(const OpcodeInfo& info) {
+	return (info.flow == Flow::NONE) ? static_cast<BYTE>(info.length - 1) : 0;
+}
+
+// instructions that only touch registers: no memory access, IME, HALT or branch
+constexpr bool registersOnly(BYTE opcode) {
+	switch (opcode) {
+	case 0x00: // NOP
+	case 0x2f: // CPL
+	case 0x37: // SCF
+	case 0x3f: // CCF
+		return true;
+	default:
+		break;
+	}
+	if ((opcode & 0xcf) == 0x01 || (opcode & 0xcf) == 0x03 || (opcode & 0xcf) == 0x0b) {
+		// LD rr, nn / INC rr / DEC rr
+		return true;
+	}
+	if ((opcode & 0xc7) == 0x04 || (opcode & 0xc7) == 0x05 || (opcode & 0xc7) == 0x06) {
+		// INC r / DEC r / LD r, n
+		return ((opcode >> 3) & 7) != 6;
+	}
+	if (0x40 <= opcode && opcode < 0x80) {
+		// LD r, r (without HALT)
+		return (opcode & 7) != 6 && ((opcode >> 3) & 7) != 6;
+	}
+	if (0x80 <= opcode && opcode < 0xc0) {
+		// ALU A, r
+		return (opcode & 7) != 6;
+	}
+	// ALU A, n
+	return (opcode & 0xc7) == 0xc6;
+}
+
+// mnemonic with the operand filled in, e.g. "LD BC, 0x1234" (nn is the word after opcode, n its low byte)
+std::string disassemble(BYTE opcode, BYTE n, WORD nn);
+
+// { mnemonic, length, cycles, takenCycles, flagsRead, flagsWritten, flow }
+constexpr std::array<OpcodeInfo, 256> OPCODES{{
+	{ "NOP", 1, 4, 0, 0, 0, Flow::NONE }, // 0x00
+	{ "LD BC, nn", 3, 12, 0, 0, 0, Flow::NONE }, // 0x01
+	{ "LD (BC), A", 1, 8, 0, 0, 0, Flow::NONE }, // 0x02
+	{ "INC BC", 1, 8, 0, 0, 0, Flow::NONE }, // 0x03
+	{ "INC B", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x04
+	{ "DEC B", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x05
+	{ "LD B, n", 2, 8, 0, 0, 0, Flow::NONE }, // 0x06
+	{ "RLCA", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x07
+	{ "LD (nn), SP", 3, 20, 0, 0, 0, Flow::NONE }, // 0x08
+	{ "ADD HL, BC", 1, 8, 0, 0, FLAG_N | FLAG_H | FLAG_C, Flow::NONE }, // 0x09
+	{ "LD A, (BC)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x0a
+	{ "DEC BC", 1, 8, 0, 0, 0, Flow::NONE }, // 0x0b
+	{ "INC C", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x0c
+	{ "DEC C", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x0d
+	{ "LD C, n", 2, 8, 0, 0, 0, Flow::NONE }, // 0x0e
+	{ "RRCA", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x0f
+	{ "STOP", 2, 4, 0, 0, 0, Flow::NONE }, // 0x10
+	{ "LD DE, nn", 3, 12, 0, 0, 0, Flow::NONE }, // 0x11
+	{ "LD (DE), A", 1, 8, 0, 0, 0, Flow::NONE }, // 0x12
+	{ "INC DE", 1, 8, 0, 0, 0, Flow::NONE }, // 0x13
+	{ "INC D", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x14
+	{ "DEC D", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x15
+	{ "LD D, n", 2, 8, 0, 0, 0, Flow::NONE }, // 0x16
+	{ "RLA", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x17
+	{ "JR n", 2, 12, 0, 0, 0, Flow::JUMP }, // 0x18
+	{ "ADD HL, DE", 1, 8, 0, 0, FLAG_N | FLAG_H | FLAG_C, Flow::NONE }, // 0x19
+	{ "LD A, (DE)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x1a
+	{ "DEC DE", 1, 8, 0, 0, 0, Flow::NONE }, // 0x1b
+	{ "INC E", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x1c
+	{ "DEC E", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x1d
+	{ "LD E, n", 2, 8, 0, 0, 0, Flow::NONE }, // 0x1e
+	{ "RRA", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x1f
+	{ "JR NZ, n", 2, 8, 12, FLAG_Z, 0, Flow::JUMP }, // 0x20
+	{ "LD HL, nn", 3, 12, 0, 0, 0, Flow::NONE }, // 0x21
+	{ "LDI (HL+), A", 1, 8, 0, 0, 0, Flow::NONE }, // 0x22
+	{ "INC HL", 1, 8, 0, 0, 0, Flow::NONE }, // 0x23
+	{ "INC H", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x24
+	{ "DEC H", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x25
+	{ "LD H, n", 2, 8, 0, 0, 0, Flow::NONE }, // 0x26
+	{ "DAA", 1, 4, 0, FLAG_N | FLAG_H | FLAG_C, FLAG_Z | FLAG_H | FLAG_C, Flow::NONE }, // 0x27
+	{ "JR Z, n", 2, 8, 12, FLAG_Z, 0, Flow::JUMP }, // 0x28
+	{ "ADD HL, HL", 1, 8, 0, 0, FLAG_N | FLAG_H | FLAG_C, Flow::NONE }, // 0x29
+	{ "LDI A, (HL+)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x2a
+	{ "DEC HL", 1, 8, 0, 0, 0, Flow::NONE }, // 0x2b
+	{ "INC L", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x2c
+	{ "DEC L", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x2d
+	{ "LD L, n", 2, 8, 0, 0, 0, Flow::NONE }, // 0x2e
+	{ "CPL", 1, 4, 0, 0, FLAG_N | FLAG_H, Flow::NONE }, // 0x2f
+	{ "JR NC, n", 2, 8, 12, FLAG_C, 0, Flow::JUMP }, // 0x30
+	{ "LD SP, nn", 3, 12, 0, 0, 0, Flow::NONE }, // 0x31
+	{ "LDD (HL-), A", 1, 8, 0, 0, 0, Flow::NONE }, // 0x32
+	{ "INC SP", 1, 8, 0, 0, 0, Flow::NONE }, // 0x33
+	{ "INC (HL)", 1, 12, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x34
+	{ "DEC (HL)", 1, 12, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x35
+	{ "LD (HL), N", 2, 12, 0, 0, 0, Flow::NONE }, // 0x36
+	{ "SCF", 1, 4, 0, 0, FLAG_N | FLAG_H | FLAG_C, Flow::NONE }, // 0x37
+	{ "JR C, n", 2, 8, 12, FLAG_C, 0, Flow::JUMP }, // 0x38
+	{ "ADD HL, SP", 1, 8, 0, 0, FLAG_N | FLAG_H | FLAG_C, Flow::NONE }, // 0x39
+	{ "LDD A, (HL-)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x3a
+	{ "DEC SP", 1, 8, 0, 0, 0, Flow::NONE }, // 0x3b
+	{ "INC A", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x3c
+	{ "DEC A", 1, 4, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x3d
+	{ "LD A, n", 2, 8, 0, 0, 0, Flow::NONE }, // 0x3e
+	{ "CCF", 1, 4, 0, FLAG_C, FLAG_N | FLAG_H | FLAG_C, Flow::NONE }, // 0x3f
+	{ "LD B, B", 1, 4, 0, 0, 0, Flow::NONE }, // 0x40
+	{ "LD B, C", 1, 4, 0, 0, 0, Flow::NONE }, // 0x41
+	{ "LD B, D", 1, 4, 0, 0, 0, Flow::NONE }, // 0x42
+	{ "LD B, E", 1, 4, 0, 0, 0, Flow::NONE }, // 0x43
+	{ "LD B, H", 1, 4, 0, 0, 0, Flow::NONE }, // 0x44
+	{ "LD B, L", 1, 4, 0, 0, 0, Flow::NONE }, // 0x45
+	{ "LD B, (HL)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x46
+	{ "LD B, A", 1, 4, 0, 0, 0, Flow::NONE }, // 0x47
+	{ "LD C, B", 1, 4, 0, 0, 0, Flow::NONE }, // 0x48
+	{ "LD C, C", 1, 4, 0, 0, 0, Flow::NONE }, // 0x49
+	{ "LD C, D", 1, 4, 0, 0, 0, Flow::NONE }, // 0x4a
+	{ "LD C, E", 1, 4, 0, 0, 0, Flow::NONE }, // 0x4b
+	{ "LD C, H", 1, 4, 0, 0, 0, Flow::NONE }, // 0x4c
+	{ "LD C, L", 1, 4, 0, 0, 0, Flow::NONE }, // 0x4d
+	{ "LD C, (HL)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x4e
+	{ "LD C, A", 1, 4, 0, 0, 0, Flow::NONE }, // 0x4f
+	{ "LD D, B", 1, 4, 0, 0, 0, Flow::NONE }, // 0x50
+	{ "LD D, C", 1, 4, 0, 0, 0, Flow::NONE }, // 0x51
+	{ "LD D, D", 1, 4, 0, 0, 0, Flow::NONE }, // 0x52
+	{ "LD D, E", 1, 4, 0, 0, 0, Flow::NONE }, // 0x53
+	{ "LD D, H", 1, 4, 0, 0, 0, Flow::NONE }, // 0x54
+	{ "LD D, L", 1, 4, 0, 0, 0, Flow::NONE }, // 0x55
+	{ "LD D, (HL)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x56
+	{ "LD D, A", 1, 4, 0, 0, 0, Flow::NONE }, // 0x57
+	{ "LD E, B", 1, 4, 0, 0, 0, Flow::NONE }, // 0x58
+	{ "LD E, C", 1, 4, 0, 0, 0, Flow::NONE }, // 0x59
+	{ "LD E, D", 1, 4, 0, 0, 0, Flow::NONE }, // 0x5a
+	{ "LD E, E", 1, 4, 0, 0, 0, Flow::NONE }, // 0x5b
+	{ "LD E, H", 1, 4, 0, 0, 0, Flow::NONE }, // 0x5c
+	{ "LD E, L", 1, 4, 0, 0, 0, Flow::NONE }, // 0x5d
+	{ "LD E, (HL)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x5e
+	{ "LD E, A", 1, 4, 0, 0, 0, Flow::NONE }, // 0x5f
+	{ "LD H, B", 1, 4, 0, 0, 0, Flow::NONE }, // 0x60
+	{ "LD H, C", 1, 4, 0, 0, 0, Flow::NONE }, // 0x61
+	{ "LD H, D", 1, 4, 0, 0, 0, Flow::NONE }, // 0x62
+	{ "LD H, E", 1, 4, 0, 0, 0, Flow::NONE }, // 0x63
+	{ "LD H, H", 1, 4, 0, 0, 0, Flow::NONE }, // 0x64
+	{ "LD H, L", 1, 4, 0, 0, 0, Flow::NONE }, // 0x65
+	{ "LD H, (HL)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x66
+	{ "LD H, A", 1, 4, 0, 0, 0, Flow::NONE }, // 0x67
+	{ "LD L, B", 1, 4, 0, 0, 0, Flow::NONE }, // 0x68
+	{ "LD L, C", 1, 4, 0, 0, 0, Flow::NONE }, // 0x69
+	{ "LD L, D", 1, 4, 0, 0, 0, Flow::NONE }, // 0x6a
+	{ "LD L, E", 1, 4, 0, 0, 0, Flow::NONE }, // 0x6b
+	{ "LD L, H", 1, 4, 0, 0, 0, Flow::NONE }, // 0x6c
+	{ "LD L, L", 1, 4, 0, 0, 0, Flow::NONE }, // 0x6d
+	{ "LD L, (HL)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x6e
+	{ "LD L, A", 1, 4, 0, 0, 0, Flow::NONE }, // 0x6f
+	{ "LD (HL), B", 1, 8, 0, 0, 0, Flow::NONE }, // 0x70
+	{ "LD (HL), C", 1, 8, 0, 0, 0, Flow::NONE }, // 0x71
+	{ "LD (HL), D", 1, 8, 0, 0, 0, Flow::NONE }, // 0x72
+	{ "LD (HL), E", 1, 8, 0, 0, 0, Flow::NONE }, // 0x73
+	{ "LD (HL), H", 1, 8, 0, 0, 0, Flow::NONE }, // 0x74
+	{ "LD (HL), L", 1, 8, 0, 0, 0, Flow::NONE }, // 0x75
+	{ "HALT", 1, 4, 0, 0, 0, Flow::NONE }, // 0x76
+	{ "LD (HL), A", 1, 8, 0, 0, 0, Flow::NONE }, // 0x77
+	{ "LD A, B", 1, 4, 0, 0, 0, Flow::NONE }, // 0x78
+	{ "LD A, C", 1, 4, 0, 0, 0, Flow::NONE }, // 0x79
+	{ "LD A, D", 1, 4, 0, 0, 0, Flow::NONE }, // 0x7a
+	{ "LD A, E", 1, 4, 0, 0, 0, Flow::NONE }, // 0x7b
+	{ "LD A, H", 1, 4, 0, 0, 0, Flow::NONE }, // 0x7c
+	{ "LD A, L", 1, 4, 0, 0, 0, Flow::NONE }, // 0x7d
+	{ "LD A, (HL)", 1, 8, 0, 0, 0, Flow::NONE }, // 0x7e
+	{ "LD A, A", 1, 4, 0, 0, 0, Flow::NONE }, // 0x7f
+	{ "ADD A, B", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x80
+	{ "ADD A, C", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x81
+	{ "ADD A, D", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x82
+	{ "ADD A, E", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x83
+	{ "ADD A, H", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x84
+	{ "ADD A, L", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x85
+	{ "ADD A, (HL)", 1, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x86
+	{ "ADD A, A", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x87
+	{ "ADC A, B", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x88
+	{ "ADC A, C", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x89
+	{ "ADC A, D", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x8a
+	{ "ADC A, E", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x8b
+	{ "ADC A, H", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x8c
+	{ "ADC A, L", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x8d
+	{ "ADC A, (HL)", 1, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x8e
+	{ "ADC A, A", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x8f
+	{ "SUB A, B", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x90
+	{ "SUB A, C", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x91
+	{ "SUB A, D", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x92
+	{ "SUB A, E", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x93
+	{ "SUB A, H", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x94
+	{ "SUB A, L", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x95
+	{ "SUB A, (HL)", 1, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x96
+	{ "SUB A, A", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x97
+	{ "SBC A, B", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x98
+	{ "SBC A, C", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x99
+	{ "SBC A, D", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x9a
+	{ "SBC A, E", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x9b
+	{ "SBC A, H", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x9c
+	{ "SBC A, L", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x9d
+	{ "SBC A, (HL)", 1, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x9e
+	{ "SBC A, A", 1, 4, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x9f
+	{ "AND A, B", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa0
+	{ "AND A, C", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa1
+	{ "AND A, D", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa2
+	{ "AND A, E", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa3
+	{ "AND A, H", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa4
+	{ "AND A, L", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa5
+	{ "AND A, (HL)", 1, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa6
+	{ "AND A, A", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa7
+	{ "XOR A, B", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa8
+	{ "XOR A, C", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xa9
+	{ "XOR A, D", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xaa
+	{ "XOR A, E", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xab
+	{ "XOR A, H", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xac
+	{ "XOR A, L", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xad
+	{ "XOR A, (HL)", 1, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xae
+	{ "XOR A, A", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xaf
+	{ "OR A, B", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb0
+	{ "OR A, C", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb1
+	{ "OR A, D", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb2
+	{ "OR A, E", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb3
+	{ "OR A, H", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb4
+	{ "OR A, L", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb5
+	{ "OR A, (HL)", 1, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb6
+	{ "OR A, A", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb7
+	{ "CP A, B", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb8
+	{ "CP A, C", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xb9
+	{ "CP A, D", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xba
+	{ "CP A, E", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xbb
+	{ "CP A, H", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xbc
+	{ "CP A, L", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xbd
+	{ "CP A, (HL)", 1, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xbe
+	{ "CP A, A", 1, 4, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xbf
+	{ "RET NZ", 1, 8, 20, FLAG_Z, 0, Flow::RETURN }, // 0xc0
+	{ "POP BC", 1, 12, 0, 0, 0, Flow::NONE }, // 0xc1
+	{ "JP NZ, nn", 3, 12, 16, FLAG_Z, 0, Flow::JUMP }, // 0xc2
+	{ "JP nn", 3, 16, 0, 0, 0, Flow::JUMP }, // 0xc3
+	{ "CALL NZ, nn", 3, 12, 24, FLAG_Z, 0, Flow::CALL }, // 0xc4
+	{ "PUSH BC", 1, 16, 0, 0, 0, Flow::NONE }, // 0xc5
+	{ "ADD A, n", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xc6
+	{ "RST 0x0000", 1, 16, 0, 0, 0, Flow::CALL }, // 0xc7
+	{ "RET Z", 1, 8, 20, FLAG_Z, 0, Flow::RETURN }, // 0xc8
+	{ "RET", 1, 16, 0, 0, 0, Flow::RETURN }, // 0xc9
+	{ "JP Z, nn", 3, 12, 16, FLAG_Z, 0, Flow::JUMP }, // 0xca
+	{ "CB", 2, 0, 0, 0, 0, Flow::NONE }, // 0xcb
+	{ "CALL Z, nn", 3, 12, 24, FLAG_Z, 0, Flow::CALL }, // 0xcc
+	{ "CALL nn", 3, 24, 0, 0, 0, Flow::CALL }, // 0xcd
+	{ "ADC A, n", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0xce
+	{ "RST 0x0008", 1, 16, 0, 0, 0, Flow::CALL }, // 0xcf
+	{ "RET NC", 1, 8, 20, FLAG_C, 0, Flow::RETURN }, // 0xd0
+	{ "POP DE", 1, 12, 0, 0, 0, Flow::NONE }, // 0xd1
+	{ "JP NC, nn", 3, 12, 16, FLAG_C, 0, Flow::JUMP }, // 0xd2
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xd3
+	{ "CALL NC, nn", 3, 12, 24, FLAG_C, 0, Flow::CALL }, // 0xd4
+	{ "PUSH DE", 1, 16, 0, 0, 0, Flow::NONE }, // 0xd5
+	{ "SUB A, n", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xd6
+	{ "RST 0x0010", 1, 16, 0, 0, 0, Flow::CALL }, // 0xd7
+	{ "RET C", 1, 8, 20, FLAG_C, 0, Flow::RETURN }, // 0xd8
+	{ "RETI", 1, 16, 0, 0, 0, Flow::RETURN }, // 0xd9
+	{ "JP C, nn", 3, 12, 16, FLAG_C, 0, Flow::JUMP }, // 0xda
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xdb
+	{ "CALL C, nn", 3, 12, 24, FLAG_C, 0, Flow::CALL }, // 0xdc
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xdd
+	{ "SBC A, n", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0xde
+	{ "RST 0x0018", 1, 16, 0, 0, 0, Flow::CALL }, // 0xdf
+	{ "LD (N+0xff00), A", 2, 12, 0, 0, 0, Flow::NONE }, // 0xe0
+	{ "POP HL", 1, 12, 0, 0, 0, Flow::NONE }, // 0xe1
+	{ "LD (C+0xff00), A", 1, 8, 0, 0, 0, Flow::NONE }, // 0xe2
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xe3
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xe4
+	{ "PUSH HL", 1, 16, 0, 0, 0, Flow::NONE }, // 0xe5
+	{ "AND A, n", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xe6
+	{ "RST 0x0020", 1, 16, 0, 0, 0, Flow::CALL }, // 0xe7
+	{ "ADD SP, n", 2, 16, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xe8
+	{ "JP HL", 1, 4, 0, 0, 0, Flow::JUMP }, // 0xe9
+	{ "LD (nn), A", 3, 16, 0, 0, 0, Flow::NONE }, // 0xea
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xeb
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xec
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xed
+	{ "XOR A, n", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xee
+	{ "RST 0x0028", 1, 16, 0, 0, 0, Flow::CALL }, // 0xef
+	{ "LD A, (N+0xff00)", 2, 12, 0, 0, 0, Flow::NONE }, // 0xf0
+	{ "POP AF", 1, 12, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xf1
+	{ "LD A, (C+0xff00)", 1, 8, 0, 0, 0, Flow::NONE }, // 0xf2
+	{ "DI", 1, 4, 0, 0, 0, Flow::NONE }, // 0xf3
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xf4
+	{ "PUSH AF", 1, 16, 0, FLAGS_ALL, 0, Flow::NONE }, // 0xf5
+	{ "OR A, n", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xf6
+	{ "RST 0x0030", 1, 16, 0, 0, 0, Flow::CALL }, // 0xf7
+	{ "LD HL, SP+n", 2, 12, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xf8
+	{ "LD SP, HL", 1, 8, 0, 0, 0, Flow::NONE }, // 0xf9
+	{ "LD A, (nn)", 3, 16, 0, 0, 0, Flow::NONE }, // 0xfa
+	{ "EI", 1, 4, 0, 0, 0, Flow::NONE }, // 0xfb
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xfc
+	{ nullptr, 1, 0, 0, 0, 0, Flow::NONE }, // 0xfd
+	{ "CP A, n", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0xfe
+	{ "RST 0x0038", 1, 16, 0, 0, 0, Flow::CALL }, // 0xff
+}};
+
+// the 0xcb prefixed instructions, cycles include the prefix
+constexpr std::array<OpcodeInfo, 256> CB_OPCODES{{
+	{ "RLC B", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x00
+	{ "RLC C", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x01
+	{ "RLC D", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x02
+	{ "RLC E", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x03
+	{ "RLC H", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x04
+	{ "RLC L", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x05
+	{ "RLC (HL)", 2, 16, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x06
+	{ "RLC A", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x07
+	{ "RRC B", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x08
+	{ "RRC C", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x09
+	{ "RRC D", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x0a
+	{ "RRC E", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x0b
+	{ "RRC H", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x0c
+	{ "RRC L", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x0d
+	{ "RRC (HL)", 2, 16, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x0e
+	{ "RRC A", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x0f
+	{ "RL B", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x10
+	{ "RL C", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x11
+	{ "RL D", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x12
+	{ "RL E", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x13
+	{ "RL H", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x14
+	{ "RL L", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x15
+	{ "RL (HL)", 2, 16, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x16
+	{ "RL A", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x17
+	{ "RR B", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x18
+	{ "RR C", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x19
+	{ "RR D", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x1a
+	{ "RR E", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x1b
+	{ "RR H", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x1c
+	{ "RR L", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x1d
+	{ "RR (HL)", 2, 16, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x1e
+	{ "RR A", 2, 8, 0, FLAG_C, FLAGS_ALL, Flow::NONE }, // 0x1f
+	{ "SLA B", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x20
+	{ "SLA C", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x21
+	{ "SLA D", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x22
+	{ "SLA E", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x23
+	{ "SLA H", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x24
+	{ "SLA L", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x25
+	{ "SLA (HL)", 2, 16, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x26
+	{ "SLA A", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x27
+	{ "SRA B", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x28
+	{ "SRA C", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x29
+	{ "SRA D", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x2a
+	{ "SRA E", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x2b
+	{ "SRA H", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x2c
+	{ "SRA L", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x2d
+	{ "SRA (HL)", 2, 16, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x2e
+	{ "SRA A", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x2f
+	{ "SWAP B", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x30
+	{ "SWAP C", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x31
+	{ "SWAP D", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x32
+	{ "SWAP E", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x33
+	{ "SWAP H", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x34
+	{ "SWAP L", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x35
+	{ "SWAP (HL)", 2, 16, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x36
+	{ "SWAP A", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x37
+	{ "SRL B", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x38
+	{ "SRL C", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x39
+	{ "SRL D", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x3a
+	{ "SRL E", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x3b
+	{ "SRL H", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x3c
+	{ "SRL L", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x3d
+	{ "SRL (HL)", 2, 16, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x3e
+	{ "SRL A", 2, 8, 0, 0, FLAGS_ALL, Flow::NONE }, // 0x3f
+	{ "BIT 0, B", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x40
+	{ "BIT 0, C", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x41
+	{ "BIT 0, D", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x42
+	{ "BIT 0, E", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x43
+	{ "BIT 0, H", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x44
+	{ "BIT 0, L", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x45
+	{ "BIT 0, (HL)", 2, 16, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x46
+	{ "BIT 0, A", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x47
+	{ "BIT 1, B", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x48
+	{ "BIT 1, C", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x49
+	{ "BIT 1, D", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x4a
+	{ "BIT 1, E", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x4b
+	{ "BIT 1, H", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x4c
+	{ "BIT 1, L", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x4d
+	{ "BIT 1, (HL)", 2, 16, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x4e
+	{ "BIT 1, A", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x4f
+	{ "BIT 2, B", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x50
+	{ "BIT 2, C", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x51
+	{ "BIT 2, D", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x52
+	{ "BIT 2, E", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x53
+	{ "BIT 2, H", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x54
+	{ "BIT 2, L", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x55
+	{ "BIT 2, (HL)", 2, 16, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x56
+	{ "BIT 2, A", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x57
+	{ "BIT 3, B", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x58
+	{ "BIT 3, C", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x59
+	{ "BIT 3, D", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x5a
+	{ "BIT 3, E", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x5b
+	{ "BIT 3, H", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x5c
+	{ "BIT 3, L", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x5d
+	{ "BIT 3, (HL)", 2, 16, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x5e
+	{ "BIT 3, A", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x5f
+	{ "BIT 4, B", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x60
+	{ "BIT 4, C", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x61
+	{ "BIT 4, D", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x62
+	{ "BIT 4, E", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x63
+	{ "BIT 4, H", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x64
+	{ "BIT 4, L", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x65
+	{ "BIT 4, (HL)", 2, 16, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x66
+	{ "BIT 4, A", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x67
+	{ "BIT 5, B", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x68
+	{ "BIT 5, C", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x69
+	{ "BIT 5, D", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x6a
+	{ "BIT 5, E", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x6b
+	{ "BIT 5, H", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x6c
+	{ "BIT 5, L", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x6d
+	{ "BIT 5, (HL)", 2, 16, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x6e
+	{ "BIT 5, A", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x6f
+	{ "BIT 6, B", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x70
+	{ "BIT 6, C", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x71
+	{ "BIT 6, D", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x72
+	{ "BIT 6, E", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x73
+	{ "BIT 6, H", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x74
+	{ "BIT 6, L", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x75
+	{ "BIT 6, (HL)", 2, 16, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x76
+	{ "BIT 6, A", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x77
+	{ "BIT 7, B", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x78
+	{ "BIT 7, C", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x79
+	{ "BIT 7, D", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x7a
+	{ "BIT 7, E", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x7b
+	{ "BIT 7, H", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x7c
+	{ "BIT 7, L", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x7d
+	{ "BIT 7, (HL)", 2, 16, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x7e
+	{ "BIT 7, A", 2, 8, 0, 0, FLAG_Z | FLAG_N | FLAG_H, Flow::NONE }, // 0x7f
+	{ "RES 0, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0x80
+	{ "RES 0, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0x81
+	{ "RES 0, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0x82
+	{ "RES 0, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0x83
+	{ "RES 0, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0x84
+	{ "RES 0, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0x85
+	{ "RES 0, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0x86
+	{ "RES 0, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0x87
+	{ "RES 1, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0x88
+	{ "RES 1, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0x89
+	{ "RES 1, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0x8a
+	{ "RES 1, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0x8b
+	{ "RES 1, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0x8c
+	{ "RES 1, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0x8d
+	{ "RES 1, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0x8e
+	{ "RES 1, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0x8f
+	{ "RES 2, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0x90
+	{ "RES 2, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0x91
+	{ "RES 2, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0x92
+	{ "RES 2, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0x93
+	{ "RES 2, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0x94
+	{ "RES 2, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0x95
+	{ "RES 2, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0x96
+	{ "RES 2, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0x97
+	{ "RES 3, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0x98
+	{ "RES 3, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0x99
+	{ "RES 3, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0x9a
+	{ "RES 3, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0x9b
+	{ "RES 3, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0x9c
+	{ "RES 3, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0x9d
+	{ "RES 3, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0x9e
+	{ "RES 3, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0x9f
+	{ "RES 4, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa0
+	{ "RES 4, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa1
+	{ "RES 4, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa2
+	{ "RES 4, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa3
+	{ "RES 4, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa4
+	{ "RES 4, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa5
+	{ "RES 4, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xa6
+	{ "RES 4, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa7
+	{ "RES 5, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa8
+	{ "RES 5, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xa9
+	{ "RES 5, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xaa
+	{ "RES 5, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xab
+	{ "RES 5, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xac
+	{ "RES 5, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xad
+	{ "RES 5, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xae
+	{ "RES 5, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xaf
+	{ "RES 6, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb0
+	{ "RES 6, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb1
+	{ "RES 6, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb2
+	{ "RES 6, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb3
+	{ "RES 6, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb4
+	{ "RES 6, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb5
+	{ "RES 6, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xb6
+	{ "RES 6, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb7
+	{ "RES 7, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb8
+	{ "RES 7, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xb9
+	{ "RES 7, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xba
+	{ "RES 7, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xbb
+	{ "RES 7, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xbc
+	{ "RES 7, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xbd
+	{ "RES 7, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xbe
+	{ "RES 7, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xbf
+	{ "SET 0, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc0
+	{ "SET 0, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc1
+	{ "SET 0, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc2
+	{ "SET 0, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc3
+	{ "SET 0, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc4
+	{ "SET 0, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc5
+	{ "SET 0, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xc6
+	{ "SET 0, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc7
+	{ "SET 1, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc8
+	{ "SET 1, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xc9
+	{ "SET 1, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xca
+	{ "SET 1, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xcb
+	{ "SET 1, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xcc
+	{ "SET 1, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xcd
+	{ "SET 1, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xce
+	{ "SET 1, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xcf
+	{ "SET 2, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd0
+	{ "SET 2, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd1
+	{ "SET 2, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd2
+	{ "SET 2, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd3
+	{ "SET 2, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd4
+	{ "SET 2, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd5
+	{ "SET 2, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xd6
+	{ "SET 2, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd7
+	{ "SET 3, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd8
+	{ "SET 3, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xd9
+	{ "SET 3, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xda
+	{ "SET 3, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xdb
+	{ "SET 3, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xdc
+	{ "SET 3, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xdd
+	{ "SET 3, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xde
+	{ "SET 3, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xdf
+	{ "SET 4, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe0
+	{ "SET 4, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe1
+	{ "SET 4, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe2
+	{ "SET 4, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe3
+	{ "SET 4, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe4
+	{ "SET 4, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe5
+	{ "SET 4, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xe6
+	{ "SET 4, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe7
+	{ "SET 5, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe8
+	{ "SET 5, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xe9
+	{ "SET 5, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xea
+	{ "SET 5, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xeb
+	{ "SET 5, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xec
+	{ "SET 5, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xed
+	{ "SET 5, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xee
+	{ "SET 5, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xef
+	{ "SET 6, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf0
+	{ "SET 6, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf1
+	{ "SET 6, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf2
+	{ "SET 6, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf3
+	{ "SET 6, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf4
+	{ "SET 6, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf5
+	{ "SET 6, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xf6
+	{ "SET 6, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf7
+	{ "SET 7, B", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf8
+	{ "SET 7, C", 2, 8, 0, 0, 0, Flow::NONE }, // 0xf9
+	{ "SET 7, D", 2, 8, 0, 0, 0, Flow::NONE }, // 0xfa
+	{ "SET 7, E", 2, 8, 0, 0, 0, Flow::NONE }, // 0xfb
+	{ "SET 7, H", 2, 8, 0, 0, 0, Flow::NONE }, // 0xfc
+	{ "SET 7, L", 2, 8, 0, 0, 0, Flow::NONE }, // 0xfd
+	{ "SET 7, (HL)", 2, 16, 0, 0, 0, Flow::NONE }, // 0xfe
+	{ "SET 7, A", 2, 8, 0, 0, 0, Flow::NONE }, // 0xff
+}};
+
+// applies X to every opcode 0x00..0xff
+#define OPCODE_ROW(X, hi) \
+	X(0x##hi##0) X(0x##hi##1) X(0x##hi##2) X(0x##hi##3) X(0x##hi##4) X(0x##hi##5) X(0x##hi##6) X(0x##hi##7) \
+	X(0x##hi##8) X(0x##hi##9) X(0x##hi##a) X(0x##hi##b) X(0x##hi##c) X(0x##hi##d) X(0x##hi##e) X(0x##hi##f)
+#define OPCODE_TABLE(X) \
+	OPCODE_ROW(X, 0) OPCODE_ROW(X, 1) OPCODE_ROW(X, 2) OPCODE_ROW(X, 3) \
+	OPCODE_ROW(X, 4) OPCODE_ROW(X, 5) OPCODE_ROW(X, 6) OPCODE_ROW(X, 7) \
+	OPCODE_ROW(X, 8) OPCODE_ROW(X, 9) OPCODE_ROW(X, a) OPCODE_ROW(X, b) \
+	OPCODE_ROW(X, c) OPCODE_ROW(X, d) OPCODE_ROW(X, e) OPCODE_ROW(X, f)
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+// Counts the instructions and cycles run at every location (ROM bank and address) and keeps a
+// shadow call stack, see CPU::setProfiling(). The CPU reports calls (CALL, RST and interrupts)
+// and returns (RET, RETI), the stack is never read from memory.
+class Profiler {
+	public:
+		struct Cost {
+			uint64_t instructions = 0;
+			uint64_t cycles = 0;
+		};
+
+		// a bank << 16 | address pair
+		using Location = DWORD;
+		static Location location(BYTE bank, WORD addr) {
+			return static_cast<Location>(bank << 16 | addr);
+		}
+
+		// the location profiling starts at becomes the root of the call tree
+		explicit Profiler(Location);
+
+		void instruction(Location, DWORD cycles);
+		// a call from the given address, which the callee returns to at the other one
+		void call(Location, WORD site, WORD returnAddr);
+		// a return to the given address; frames without a matching return address are left alone,
+		// so code that drops return addresses from the stack doesn't unbalance it
+		void ret(WORD);
+
+		// everything run at the location, in any function
+		Cost at(Location) const;
+		// currently open calls, the root included
+		std::size_t depth() const {
+			return m_stack.size();
+		}
+
+		// callgrind format, for kcachegrind or callgrind_annotate
+		void writeCallgrind(std::ostream&) const;
+		// folded stacks (one "root;caller;callee cycles" line per call path), for flamegraph.pl
+		void writeFolded(std::ostream&) const;
+	private:
+		// the call tree: one node per call path
+		struct Node {
+			std::size_t parent;
+			Location function;
+			// where the parent called from
+			WORD site;
+			uint64_t calls = 0;
+			Cost self;
+		};
+		std::vector<Node> m_nodes;
+		std::map<std::tuple<std::size_t, WORD, Location>, std::size_t> m_children;
+
+		struct Frame {
+			std::size_t node;
+			WORD returnAddr;
+		};
+		std::vector<Frame> m_stack;
+
+		// deeper calls are counted as jumps, for code that never returns
+		static const std::size_t MAX_DEPTH = 1024;
+
+		// per function << 32 | location, a function's lines in the callgrind output
+		std::unordered_map<uint64_t, Cost> m_costs;
+
+		// inclusive cost of every node
+		std::vector<Cost> inclusive() const;
+};
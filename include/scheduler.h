@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+#include "gpu.h"
+
+// Runs the components of the machine (CPU, GPU, later the timer and the APU) as resumable tasks,
+// each with its own clock: a task runs until it has to wait for a number of cycles and is resumed
+// once every other task has caught up to it. Tasks keep where they left off in their own state,
+// so resuming one doesn't decode anything.
+class Scheduler {
+	public:
+		class Task {
+			public:
+				virtual ~Task() = default;
+
+				// runs from time() on and suspends itself at the latest at the limit (plus one
+				// indivisible step), which is when the next other task is due
+				virtual void resume(uint64_t limit) = 0;
+
+				uint64_t time() const {
+					return m_time;
+				}
+				void setTime(uint64_t time_) {
+					m_time = time_;
+				}
+			protected:
+				uint64_t m_time = 0;
+		};
+
+		// tasks due at the same time are resumed in the order they were added
+		void add(Task& task) {
+			m_tasks.push_back(&task);
+		}
+
+		// Resumes the task furthest behind, unless all of them have reached the time. Returns the
+		// task resumed, nullptr if there was none.
+		Task* resumeNext(uint64_t until) {
+			Task* next = nullptr;
+			uint64_t limit = until;
+			for (Task* task : m_tasks) {
+				if (next == nullptr || task->time() < next->time()) {
+					if (next != nullptr && next->time() < limit) {
+						limit = next->time();
+					}
+					next = task;
+				} else if (task->time() < limit) {
+					limit = task->time();
+				}
+			}
+			if (next == nullptr || next->time() >= until) {
+				return nullptr;
+			}
+			next->resume(limit);
+			return next;
+		}
+	private:
+		std::vector<Task*> m_tasks;
+};
+
+// Runs the CPU in batches up to the limit. Add it after the tasks whose state it reads, so they
+// are up to date when it is due at the same time.
+template <typename Cpu>
+class CpuTask final : public Scheduler::Task {
+	public:
+		explicit CpuTask(Cpu& cpu_) : m_cpu{cpu_} {}
+
+		void resume(uint64_t limit) override {
+			m_time += m_cpu.run(static_cast<DWORD>(std::min<uint64_t>(limit - m_time, 0xffffffff)));
+		}
+	private:
+		Cpu& m_cpu;
+};
+
+// Wakes up for every mode change.
+class GpuTask final : public Scheduler::Task {
+	public:
+		explicit GpuTask(GPU& gpu_) : m_gpu{gpu_} {}
+
+		void resume(uint64_t) override {
+			m_time += m_gpu.advance();
+		}
+	private:
+		GPU& m_gpu;
+};
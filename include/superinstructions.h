@@ -0,0 +1,21 @@
+#pragma once
+
+// Generated by `gb <rom> <breakpoint> --profile-pairs` (CPU::writeSuperinstructions()): the most
+// frequent pairs of opcodes, which the cached engine runs with a single dispatch.
+#define SUPERINSTRUCTIONS(X) \
+	X(0xfe, 0x20) /* CP A, n; JR NZ, n: 720702 */ \
+	X(0xf0, 0xfe) /* LD A, (N+0xff00); CP A, n: 720475 */ \
+	X(0x32, 0xcb) /* LDD (HL-), A; CB: 8192 */ \
+	X(0xcb, 0x20) /* CB; JR NZ, n: 8192 */ \
+	X(0x0d, 0x20) /* DEC C; JR NZ, n: 3192 */ \
+	X(0xcb, 0x17) /* CB; RLA: 768 */ \
+	X(0x05, 0x20) /* DEC B; JR NZ, n: 419 */ \
+	X(0x17, 0xc1) /* RLA; POP BC: 384 */ \
+	X(0x17, 0x05) /* RLA; DEC B: 384 */ \
+	X(0xc1, 0xcb) /* POP BC; CB: 384 */ \
+	X(0xc5, 0xcb) /* PUSH BC; CB: 384 */ \
+	X(0x0e, 0xf0) /* LD C, n; LD A, (N+0xff00): 264 */ \
+	X(0x1d, 0x20) /* DEC E; JR NZ, n: 264 */ \
+	X(0x1e, 0xfe) /* LD E, n; CP A, n: 263 */ \
+	X(0x22, 0x23) /* LDI (HL+), A; INC HL: 200 */ \
+	X(0x90, 0xe0) /* SUB A, B; LD (N+0xff00), A: 132 */
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+
+#include "types.h"
+#include "immu.h"
+#include "mmu.h"
+#include "gpu.h"
+
+// The bus of the M-cycle accurate mode (see Emulator::setCycleAccurate()): every memory access
+// takes one M-cycle, the GPU is ticked by it before the access reaches the MMU.
+class TimedBus final : public IMMU {
+	public:
+		TimedBus(MMU& mmu_, GPU& gpu_) : m_mmu{mmu_}, m_gpu{gpu_} {}
+
+		BYTE readByte(WORD addr) override {
+			tick();
+			return m_mmu.readByte(addr);
+		}
+
+		void writeByte(WORD addr, BYTE v) override {
+			tick();
+			m_mmu.writeByte(addr, v);
+			changed(addr);
+		}
+
+		// Call after every instruction with its cycles: the GPU is ticked for the cycles without a
+		// memory access, which come last. Returns the cycles that passed, the accesses' if they took
+		// longer. Call with 0 after an interrupt dispatch to count its stack writes. Picks up the
+		// MMU's ROM bank, which may also have been switched while the other CPU ran.
+		DWORD complete(DWORD cycles) {
+			bankWritten(m_mmu.romBank(), m_mmu.bankGeneration());
+			DWORD total = std::max(cycles, m_ticked);
+			m_gpu.step(total - m_ticked);
+			m_ticked = 0;
+			return total;
+		}
+	private:
+		MMU& m_mmu;
+		GPU& m_gpu;
+		// cycles ticked since the last complete()
+		DWORD m_ticked = 0;
+
+		void tick() {
+			m_gpu.step(4);
+			m_ticked += 4;
+		}
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "types.h"
+
+// One instruction as step() is about to run it: the registers before it and the cycles run
+// since tracing started.
+struct TraceEntry {
+	uint64_t stamp;
+	WORD pc;
+	WORD af;
+	WORD bc;
+	WORD de;
+	WORD hl;
+	WORD sp;
+	BYTE opcode;
+	// the bytes after the opcode, as many as the instruction has
+	BYTE operands[2];
+	BYTE unused;
+};
+
+static_assert(std::is_trivially_copyable<TraceEntry>::value, "traces are written as they are in memory");
+static_assert(sizeof(TraceEntry) == 24, "TraceEntry should have no padding");
+
+// The last instructions run, in a fixed-size ring buffer, see CPU::setTracing(). Saved traces are
+// a header and the entries in host byte order, oldest first; gb-trace prints and diffs them.
+class Trace {
+	public:
+		// the capacity is rounded up to a power of two
+		explicit Trace(std::size_t);
+
+		void record(TraceEntry entry) {
+			entry.stamp = m_cycles;
+			m_entries[m_next++ & m_mask] = entry;
+		}
+		void elapse(DWORD cycles) {
+			m_cycles += cycles;
+		}
+
+		// oldest first
+		std::vector<TraceEntry> entries() const;
+
+		void write(std::ostream&) const;
+		// like write(), but only calls write(2), so it can be used from a signal handler
+		bool dump(int fd) const noexcept;
+		// throws std::runtime_error if the stream doesn't hold a trace
+		static std::vector<TraceEntry> read(std::istream&);
+
+		// stamp, address, bytes, disassembly and registers on one line
+		static std::string format(const TraceEntry&);
+	private:
+		std::vector<TraceEntry> m_entries;
+		std::size_t m_mask;
+		// entries recorded so far
+		uint64_t m_next = 0;
+		uint64_t m_cycles = 0;
+
+		struct Header {
+			char magic[8];
+			uint32_t entrySize;
+			uint32_t count;
+		};
+		Header header() const noexcept;
+		// where the oldest entry is in m_entries
+		std::size_t first() const noexcept;
+};
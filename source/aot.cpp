@@ -0,0 +1,116 @@
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include "aot.h"
+#include "cpu.h"
+#include "opcodes.h"
+
+namespace {
+std::vector<const AotProgram*>& programs() {
+	static std::vector<const AotProgram*> linked;
+	return linked;
+}
+
+class NullBus final : public IMMU {
+	public:
+		BYTE readByte(WORD) override {
+			return 0;
+		}
+		void writeByte(WORD, BYTE) override {}
+};
+
+// which opcodes the interpreter has, the others are left to step() to report
+class ProbeCPU : public CPU {
+	public:
+		using BasicCPU<IMMU>::BasicCPU;
+
+		bool implemented(BYTE opcode) const {
+			return m_instructions[opcode].opcode == opcode;
+		}
+};
+
+// as many as CPU::decodeBlock() puts into a block
+const std::size_t MAX_OPS = 64;
+
+std::string hex(unsigned v, int width) {
+	std::ostringstream s;
+	s << "0x" << std::hex << std::setfill('0') << std::setw(width) << v;
+	return s.str();
+}
+}
+
+const AotProgram* AotProgram::find(WORD checksum) {
+	for (const AotProgram* program : programs()) {
+		if (program->checksum == checksum) {
+			return program;
+		}
+	}
+	return nullptr;
+}
+
+AotRegistration::AotRegistration(const AotProgram& program) {
+	programs().push_back(&program);
+}
+
+void writeAot(std::ostream& out, Mapper& rom, const CodeMap& map, const std::string& name) {
+	NullBus bus;
+	InterruptState intState;
+	ProbeCPU probe{bus, intState, CPU::Engine::Table};
+
+	out << "// Written by gb-aot from " << name << ", see aot.h.\n"
+		<< "#include \"aot.h\"\n#include \"cpuimpl.h\"\n\nnamespace {\n"
+		<< "using AotCPU = BasicCPU<MMU>;\n";
+
+	std::ostringstream table;
+	for (WORD start : map.blocks()) {
+		// straight-line code the map knows, up to a branch or HALT like the cached engine's blocks
+		std::ostringstream bytes;
+		std::ostringstream body;
+		DWORD addr = start;
+		std::size_t ops = 0;
+		while (ops < MAX_OPS && addr < CodeMap::SIZE && (addr == start || map.code(static_cast<WORD>(addr)))) {
+			BYTE opcode = rom.readByte(static_cast<WORD>(addr));
+			const auto& info = OPCODES[opcode];
+			if (!probe.implemented(opcode) || addr + info.length > CodeMap::SIZE) {
+				break;
+			}
+			BYTE n = info.length == 2 ? rom.readByte(static_cast<WORD>(addr + 1)) : 0;
+			WORD nn = info.length == 3 ? static_cast<WORD>(rom.readByte(static_cast<WORD>(addr + 1)) | rom.readByte(static_cast<WORD>(addr + 2)) << 8) : 0;
+			for (DWORD i = 0; i < info.length; i++) {
+				bytes << (addr + i == start ? "" : ", ") << hex(rom.readByte(static_cast<WORD>(addr + i)), 2);
+			}
+			BYTE operand = info.length == 3 ? static_cast<BYTE>(nn) : n;
+			body << "\tif (!cpu.runAot<" << hex(opcode, 2) << ">(" << hex(n, 2) << ", " << hex(nn, 4)
+				<< ", total, budget)) return total; // " << hex(addr, 4) << ": " << disassemble(opcode, operand, nn) << '\n';
+			addr += info.length;
+			ops++;
+			if (info.flow != Flow::NONE || opcode == 0x76) {
+				break;
+			}
+		}
+		if (ops == 0) {
+			continue;
+		}
+
+		BYTE bank = start >= 0x4000 ? rom.romBank() : 0;
+		std::string id = hex(bank, 2).substr(2) + '_' + hex(start, 4).substr(2);
+		out << "\nconst BYTE bytes_" << id << "[] = { " << bytes.str() << " };\n"
+			<< "DWORD block_" << id << "(void* self, DWORD budget) {\n"
+			<< "\tauto& cpu = *static_cast<AotCPU*>(self);\n"
+			<< "\tDWORD total = 0;\n"
+			<< body.str()
+			<< "\treturn total;\n}\n";
+		table << "\t{ " << hex(bank, 2) << ", " << hex(start, 4) << ", bytes_" << id << ", " << (addr - start) << ", block_" << id << " },\n";
+	}
+
+	WORD checksum = static_cast<WORD>(rom.readByte(0x014e) << 8 | rom.readByte(0x014f));
+	if (table.str().empty()) {
+		out << "\nconst AotProgram program{" << hex(checksum, 4) << ", nullptr, 0};\n";
+	} else {
+		out << "\nconst AotBlock blocks[] = {\n" << table.str() << "};\n"
+			<< "const AotProgram program{" << hex(checksum, 4) << ", blocks, sizeof(blocks) / sizeof(blocks[0])};\n";
+	}
+	out << "const AotRegistration registration{program};\n}\n";
+}
@@ -0,0 +1,28 @@
+#include <algorithm>
+
+#include "blockcache.h"
+
+BlockCache::Block& BlockCache::insert(BYTE bank, WORD addr, BYTE firstPage, BYTE lastPage, Block&& block) {
+	Key start = key(bank, addr);
+	for (int page = firstPage; page <= lastPage; page++) {
+		auto& starts = m_pages[static_cast<std::size_t>(page)];
+		if (std::find(starts.begin(), starts.end(), start) == starts.end()) {
+			starts.push_back(start);
+		}
+	}
+	return m_blocks[start] = std::move(block);
+}
+
+void BlockCache::invalidatePage(BYTE page) {
+	for (Key start : m_pages[page]) {
+		m_blocks.erase(start);
+	}
+	m_pages[page].clear();
+}
+
+void BlockCache::clear() {
+	m_blocks.clear();
+	for (auto& starts : m_pages) {
+		starts.clear();
+	}
+}
@@ -0,0 +1,146 @@
+#include <cstring>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "codemap.h"
+#include "opcodes.h"
+
+static const char MAGIC[8] = {'G', 'B', 'C', 'O', 'D', 'E', 'M', '1'};
+
+CodeMap CodeMap::discover(Mapper& rom) {
+	CodeMap map;
+	auto& flags = map.m_flags;
+
+	std::vector<WORD> work{0x0100};
+	for (WORD vector = 0x00; vector <= 0x60; vector = static_cast<WORD>(vector + 8)) {
+		work.push_back(vector);
+	}
+	for (WORD entry : work) {
+		flags[entry] |= ENTRY | BLOCK;
+	}
+	auto branch = [&](DWORD target) {
+		if (target < SIZE) {
+			flags[target] |= LABEL | BLOCK;
+			work.push_back(static_cast<WORD>(target));
+		}
+	};
+
+	while (!work.empty()) {
+		DWORD addr = work.back();
+		work.pop_back();
+		// straight-line code up to an unconditional jump or return, or code found before
+		while (addr < SIZE && (flags[addr] & CODE) == 0) {
+			BYTE opcode = rom.readByte(static_cast<WORD>(addr));
+			const auto& info = OPCODES[opcode];
+			if (info.mnemonic == nullptr || addr + info.length > SIZE) {
+				break;
+			}
+			flags[addr] |= CODE;
+			for (DWORD i = 1; i < info.length; i++) {
+				flags[addr + i] |= OPERAND;
+			}
+			BYTE n = info.length > 1 ? rom.readByte(static_cast<WORD>(addr + 1)) : 0;
+			WORD nn = info.length > 2 ? static_cast<WORD>(n | rom.readByte(static_cast<WORD>(addr + 2)) << 8) : 0;
+			DWORD next = addr + info.length;
+			bool conditional = (info.takenCycles != 0);
+
+			bool fallsThrough = true;
+			switch (info.flow) {
+			case Flow::NONE:
+				break;
+			case Flow::JUMP:
+				if (opcode == 0xe9) {
+					// JP HL: the target isn't known
+					fallsThrough = false;
+					break;
+				}
+				branch(info.length == 2 ? static_cast<WORD>(static_cast<int>(next) + static_cast<int8_t>(n)) : nn);
+				fallsThrough = conditional;
+				break;
+			case Flow::CALL:
+				// RST n has its target in the opcode
+				branch(info.length == 1 ? opcode & 0x38 : nn);
+				break;
+			case Flow::RETURN:
+				fallsThrough = conditional;
+				break;
+			}
+			if (!fallsThrough) {
+				break;
+			}
+			// blocks end after branches and HALT
+			if (next < SIZE && (info.flow != Flow::NONE || opcode == 0x76)) {
+				flags[next] |= BLOCK;
+			}
+			addr = next;
+		}
+	}
+	return map;
+}
+
+std::vector<WORD> CodeMap::blocks() const {
+	std::vector<WORD> starts;
+	for (std::size_t addr = 0; addr < SIZE; addr++) {
+		if ((m_flags[addr] & (CODE | BLOCK)) == (CODE | BLOCK)) {
+			starts.push_back(static_cast<WORD>(addr));
+		}
+	}
+	return starts;
+}
+
+void CodeMap::write(std::ostream& out) const {
+	out.write(MAGIC, sizeof(MAGIC));
+	out.write(static_cast<const char*>(static_cast<const void*>(m_flags.data())), SIZE);
+}
+
+CodeMap CodeMap::read(std::istream& in) {
+	char magic[sizeof(MAGIC)];
+	CodeMap map;
+	in.read(magic, sizeof(magic));
+	in.read(static_cast<char*>(static_cast<void*>(map.m_flags.data())), SIZE);
+	if (!in || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+		throw std::runtime_error{"Not a code map"};
+	}
+	return map;
+}
+
+void CodeMap::writeDisassembly(std::ostream& out, Mapper& rom) const {
+	out << std::hex << std::setfill('0');
+	for (std::size_t addr = 0; addr < SIZE;) {
+		BYTE f = m_flags[addr];
+		if ((f & CODE) == 0) {
+			// data up to the next instruction, 16 bytes per line
+			out << "    " << std::setw(4) << addr << "  DB";
+			for (std::size_t i = 0; i < 16 && addr < SIZE && (m_flags[addr] & CODE) == 0; i++, addr++) {
+				out << (i == 0 ? " " : ", ") << "0x" << std::setw(2) << +rom.readByte(static_cast<WORD>(addr));
+			}
+			out << '\n';
+			continue;
+		}
+
+		if ((f & (LABEL | ENTRY)) != 0) {
+			out << "\nL" << std::setw(4) << addr << ':' << ((f & ENTRY) != 0 ? " ; entry point" : "") << '\n';
+		}
+		BYTE opcode = rom.readByte(static_cast<WORD>(addr));
+		const auto& info = OPCODES[opcode];
+		BYTE n = info.length > 1 ? rom.readByte(static_cast<WORD>(addr + 1)) : 0;
+		WORD nn = info.length > 2 ? static_cast<WORD>(n | rom.readByte(static_cast<WORD>(addr + 2)) << 8) : 0;
+
+		std::ostringstream bytes;
+		bytes << std::hex << std::setfill('0') << std::setw(2) << +opcode;
+		for (std::size_t i = 1; i < info.length; i++) {
+			bytes << ' ' << std::setw(2) << +rom.readByte(static_cast<WORD>(addr + i));
+		}
+		out << "    " << std::setw(4) << addr << "  " << std::setfill(' ') << std::left << std::setw(10) << bytes.str();
+		out << disassemble(opcode, n, nn) << std::right << std::setfill('0');
+		// relative jumps are shown with their target
+		if (info.flow == Flow::JUMP && info.length == 2) {
+			out << " ; L" << std::setw(4) << static_cast<WORD>(static_cast<int>(addr) + 2 + static_cast<int8_t>(n));
+		}
+		out << '\n';
+		addr += info.length;
+	}
+}
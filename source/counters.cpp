@@ -0,0 +1,38 @@
+#include <ostream>
+
+#include "counters.h"
+
+namespace {
+const char* const REGION_NAMES[Counters::REGIONS] = { "rom", "vram", "wram", "oam", "io", "hram" };
+}
+
+constexpr bool Counters::enabled;
+
+Counters& Counters::operator+=(const Counters& other) {
+	instructions += other.instructions;
+	cycles += other.cycles;
+	for (std::size_t i = 0; i < REGIONS; i++) {
+		reads[i] += other.reads[i];
+		writes[i] += other.writes[i];
+	}
+	interrupts += other.interrupts;
+	modeChanges += other.modeChanges;
+	dmaTransfers += other.dmaTransfers;
+	frames += other.frames;
+	return *this;
+}
+
+void Counters::write(std::ostream& out) const {
+	out << "instructions " << instructions << '\n'
+		<< "cycles " << cycles << '\n';
+	for (std::size_t i = 0; i < REGIONS; i++) {
+		out << "reads." << REGION_NAMES[i] << ' ' << reads[i] << '\n';
+	}
+	for (std::size_t i = 0; i < REGIONS; i++) {
+		out << "writes." << REGION_NAMES[i] << ' ' << writes[i] << '\n';
+	}
+	out << "interrupts " << interrupts << '\n'
+		<< "mode_changes " << modeChanges << '\n'
+		<< "dma_transfers " << dmaTransfers << '\n'
+		<< "frames " << frames << '\n';
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "emulator.h"
+
+Emulator::Emulator(std::unique_ptr<Mapper>&& mapper_, IDisplay& display_, CPU::Engine engine_) :
+	m_intState{},
+	m_gpu{display_, m_intState},
+	m_mmu{std::move(mapper_), m_gpu, m_intState},
+	m_cpu{m_mmu, m_intState, engine_},
+	m_timedBus{m_mmu, m_gpu},
+	m_accurateCpu{m_timedBus, m_intState, CPU::Engine::Switch},
+	m_gpuTask{m_gpu},
+	m_cpuTask{m_cpu}
+{
+	// the GPU goes first when both are due, so the CPU sees its mode change
+	m_scheduler.add(m_gpuTask);
+	m_scheduler.add(m_cpuTask);
+}
+
+void Emulator::setCycleAccurate(bool accurate) {
+	if (accurate && !m_cycleAccurate) {
+		m_accurateCpu.restore(m_cpu.snapshot());
+	} else if (!accurate && m_cycleAccurate) {
+		m_cpu.restore(m_accurateCpu.snapshot());
+	}
+	if (accurate) {
+		setScheduled(false);
+	}
+	m_cycleAccurate = accurate;
+}
+
+void Emulator::setScheduled(bool scheduled_) {
+	if (scheduled_ && !m_scheduled) {
+		setCycleAccurate(false);
+		m_cpuTask.setTime(0);
+		m_gpuTask.setTime(m_gpu.cyclesUntilEvent());
+	} else if (!scheduled_ && m_scheduled) {
+		// the GPU task leaves the GPU at the start of the mode it is due to end, the CPU may have
+		// passed that by one instruction
+		m_gpu.step(static_cast<DWORD>(m_gpu.cyclesUntilEvent() + m_cpuTask.time() - m_gpuTask.time()));
+	}
+	m_scheduled = scheduled_;
+}
+
+CPUState Emulator::snapshot() {
+	return m_cycleAccurate ? m_accurateCpu.snapshot() : m_cpu.snapshot();
+}
+
+void Emulator::restore(const CPUState& state) {
+	if (m_cycleAccurate) {
+		m_accurateCpu.restore(state);
+	} else {
+		m_cpu.restore(state);
+	}
+}
+
+DWORD Emulator::stepAccurate() {
+	m_accurateCpu.handleInterrupts();
+	DWORD dispatch = m_timedBus.complete(0);
+	return dispatch + m_timedBus.complete(m_accurateCpu.step());
+}
+
+void Emulator::sync(Summary& summary, DWORD budget) {
+	DWORD frames = m_gpu.frames();
+	uint64_t skipped = m_cpu.skippedCycles();
+	DWORD cycles = 0;
+	if (m_cycleAccurate) {
+		// the GPU is up to date after every instruction
+		while (cycles < budget) {
+			cycles += stepAccurate();
+		}
+	} else {
+		// the CPU overshoots by at most one instruction, which the GPU carries over
+		cycles = m_cpu.run(std::min(budget, m_gpu.cyclesUntilEvent()));
+		m_gpu.step(cycles);
+	}
+
+	summary.cycles += cycles;
+	GB_COUNT(m_counters.cycles += cycles);
+	summary.frames += m_gpu.frames() - frames;
+	summary.skipped += static_cast<DWORD>(m_cpu.skippedCycles() - skipped);
+	summary.syncs++;
+}
+
+Emulator::Summary Emulator::runScheduled(DWORD cycles, bool frame) {
+	Summary summary{};
+	DWORD frames = m_gpu.frames();
+	uint64_t skipped = m_cpu.skippedCycles();
+	uint64_t start = m_cpuTask.time();
+	uint64_t until = frame ? UINT64_MAX : start + cycles;
+	while (Scheduler::Task* task = m_scheduler.resumeNext(until)) {
+		if (task == &m_gpuTask) {
+			summary.syncs++;
+			if (frame && m_gpu.frames() != frames) {
+				break;
+			}
+		}
+	}
+
+	summary.cycles = static_cast<DWORD>(m_cpuTask.time() - start);
+	GB_COUNT(m_counters.cycles += summary.cycles);
+	summary.frames = m_gpu.frames() - frames;
+	summary.skipped = static_cast<DWORD>(m_cpu.skippedCycles() - skipped);
+	return summary;
+}
+
+Emulator::Summary Emulator::runFor(DWORD cycles) {
+	if (m_scheduled) {
+		return runScheduled(cycles, false);
+	}
+	Summary summary{};
+	while (summary.cycles < cycles) {
+		sync(summary, cycles - summary.cycles);
+	}
+	return summary;
+}
+
+Emulator::Summary Emulator::runFrame() {
+	if (m_scheduled) {
+		return runScheduled(0, true);
+	}
+	Summary summary{};
+	while (summary.frames == 0) {
+		sync(summary, m_gpu.cyclesUntilEvent());
+	}
+	return summary;
+}
+
+Counters Emulator::counters() const {
+	Counters total = m_counters;
+	total += m_cpu.counters();
+	total += m_accurateCpu.counters();
+	total += m_mmu.counters();
+	total += m_gpu.counters();
+	return total;
+}
@@ -1,15 +1,29 @@
 #include <iostream>
 #include <exception>
+#include <fstream>
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <string>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
 #include <SDL2/SDL.h>
 
 #include "mapper.h"
-#include "mmu.h"
 #include "cpu.h"
-#include "gpu.h"
-#include "interruptstate.h"
+#include "display.h"
+#include "emulator.h"
+#include "gdbstub.h"
+#include "codemap.h"
+#include "aot.h"
+#include "trace.h"
+
+#ifdef GB_THREADED
+static const CPU::Engine ENGINE = CPU::Engine::Threaded;
+#else
+static const CPU::Engine ENGINE = CPU::Engine::Switch;
+#endif
 
 template <typename Fun>
 struct ScopeGuard {
@@ -23,10 +37,80 @@ ScopeGuard<Fun> guard(Fun&& f) {
 	return ScopeGuard<Fun>{std::move(f)};
 }
 
-int main(int argc, char *argv[]) {
-	(void)argc;
+static const std::size_t TRACE_ENTRIES = 1 << 16;
+static const char* const TRACE_FILE = "gb.trace";
+
+// the trace to dump if gb crashes
+static const Trace* s_trace = nullptr;
+
+static void dumpTrace(int signal) {
+	int fd = open(TRACE_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd >= 0) {
+		s_trace->dump(fd);
+		close(fd);
+	}
+	std::signal(signal, SIG_DFL);
+	std::raise(signal);
+}
 
+int main(int argc, char *argv[]) {
 	bool quit = false;
+
+	// gb <rom> [<breakpoint>] [--gdb <port>] [--code-map <map>] [--jit] [--lazy-flags] [--skip-idle] [--profile] [--profile-pairs] [--trace] [--accurate] [--scheduler] [--aot] [--counters]
+	// <breakpoint>: hex address to start the console single-stepper at, bank:address (e.g. 02:4000)
+	//               for one ROM bank only
+	// --gdb: wait for GDB on localhost:<port> (target remote localhost:<port>)
+	// --code-map: decode the code found by gb-disasm ahead of time (with --jit)
+	// --profile: write callgrind.out.gb (kcachegrind) and gb.folded (flamegraph.pl) on exit
+	// --profile-pairs: print a superinstructions.h for the pairs of opcodes run most on exit
+	// --trace: keep the last instructions and write them to gb.trace on errors and crashes (see gb-trace)
+	// --accurate: tick the GPU before every memory access (slower, the options above don't apply)
+	// --aot: run the code gb-aot translated from the ROM, if it is linked in (make AOT=...)
+	// --scheduler: run the CPU and the GPU as tasks of the scheduler (--accurate takes precedence)
+	// --counters: write the performance counters to gb.counters on exit (make COUNTERS=1)
+	bool jit = false;
+	bool lazyFlags = false;
+	bool skipIdle = false;
+	bool profile = false;
+	bool profilePairs = false;
+	bool trace = false;
+	bool accurate = false;
+	bool scheduler = false;
+	bool aot = false;
+	bool counters = false;
+	bool hasBreakpoint = false;
+	int breakpointBank = -1;
+	WORD breakpoint = 0;
+	WORD gdbPort = 0;
+	std::string codeMap;
+	for (int i = 2; i < argc; i++) {
+		std::string option{argv[i]};
+		if (i == 2 && option.compare(0, 2, "--") != 0) {
+			hasBreakpoint = true;
+			char* end = nullptr;
+			breakpoint = static_cast<WORD>(strtoul(argv[i], &end, 16));
+			if (*end == ':') {
+				breakpointBank = breakpoint;
+				breakpoint = static_cast<WORD>(strtoul(end + 1, NULL, 16));
+			}
+		} else if (option == "--gdb" && i + 1 < argc) {
+			gdbPort = static_cast<WORD>(strtoul(argv[++i], NULL, 10));
+		} else if (option == "--code-map" && i + 1 < argc) {
+			codeMap = argv[++i];
+		}
+		jit = jit || option == "--jit";
+		lazyFlags = lazyFlags || option == "--lazy-flags";
+		skipIdle = skipIdle || option == "--skip-idle";
+		profile = profile || option == "--profile";
+		profilePairs = profilePairs || option == "--profile-pairs";
+		trace = trace || option == "--trace";
+		accurate = accurate || option == "--accurate";
+		scheduler = scheduler || option == "--scheduler";
+		aot = aot || option == "--aot";
+		counters = counters || option == "--counters";
+	}
+	// translated code runs on the cached engines
+	CPU::Engine engine = jit ? CPU::Engine::Jit : (aot ? CPU::Engine::Cached : ENGINE);
 	
 	// TODO: error handling
 	SDL_Init(SDL_INIT_VIDEO);
@@ -34,25 +118,87 @@ int main(int argc, char *argv[]) {
 	SDL_Event ev = { 0 };
 
 	try {
-		InterruptState intState{};
 		Display display{};
-		GPU gpu{display, intState};
-		auto mapper = Mapper::fromFile(argv[1]);
-		MMU mmu{std::move(mapper), gpu, intState};
-		CPU cpu{mmu, intState, static_cast<WORD>(strtoul(argv[2], NULL, 16))};
-
-		while (!quit) {
-			cpu.handleInterrupts();
-			DWORD cycles = cpu.step();
-			gpu.step(cycles);
-			//std::cin.get();
-			
-			SDL_PollEvent(&ev);
-			switch (ev.type) {
-			case SDL_QUIT:
-				quit = true;
-				break;
+		Emulator emulator{Mapper::fromFile(argv[1]), display, engine};
+		if (!codeMap.empty()) {
+			std::ifstream in{codeMap, std::ios::binary};
+			emulator.cpu().setCodeMap(CodeMap::read(in));
+		}
+		if (aot) {
+			auto& mmu = emulator.mmu();
+			const AotProgram* program = AotProgram::find(static_cast<WORD>(mmu.readByte(0x014e) << 8 | mmu.readByte(0x014f)));
+			if (program == nullptr) {
+				std::cerr << "No translated code for this ROM is linked in, see gb-aot\n";
+			}
+			emulator.cpu().setAot(program);
+		}
+		if (hasBreakpoint && breakpointBank >= 0) {
+			emulator.cpu().setBankBreakpoint(static_cast<BYTE>(breakpointBank), breakpoint);
+		} else if (hasBreakpoint) {
+			emulator.cpu().setBreakpoint(breakpoint);
+		}
+		std::unique_ptr<GdbStub> gdb;
+		if (gdbPort != 0) {
+			gdb.reset(new GdbStub{emulator.mmu(), gdbPort});
+			emulator.cpu().setDebugger(gdb.get());
+		}
+		emulator.cpu().setLazyFlags(lazyFlags);
+		emulator.cpu().setIdleSkipping(skipIdle);
+		emulator.cpu().setProfiling(profile);
+		emulator.cpu().setPairProfiling(profilePairs);
+		emulator.setScheduled(scheduler);
+		emulator.setCycleAccurate(accurate);
+		if (trace) {
+			emulator.cpu().setTracing(TRACE_ENTRIES);
+			s_trace = emulator.cpu().trace();
+			std::signal(SIGSEGV, dumpTrace);
+			std::signal(SIGABRT, dumpTrace);
+			std::signal(SIGFPE, dumpTrace);
+		}
+		if (counters && !Counters::enabled) {
+			std::cerr << "gb was built without counters, see make COUNTERS=1\n";
+		}
+		auto profiles = guard([&emulator, profilePairs, counters](){
+			if (emulator.cpu().profiler()) {
+				std::ofstream callgrind{"callgrind.out.gb"};
+				emulator.cpu().profiler()->writeCallgrind(callgrind);
+				std::ofstream folded{"gb.folded"};
+				emulator.cpu().profiler()->writeFolded(folded);
+			}
+			if (profilePairs) {
+				emulator.cpu().writeSuperinstructions(std::cout, 16);
+			}
+			if (counters && Counters::enabled) {
+				std::ofstream out{"gb.counters"};
+				emulator.counters().write(out);
+			}
+		});
+
+		try {
+			while (!quit) {
+				emulator.runFrame();
+				if (gdb && !gdb->attached()) {
+					emulator.cpu().setDebugger(nullptr);
+					gdb.reset();
+				} else if (gdb && gdb->interrupted()) {
+					emulator.cpu().requestStop();
+				}
+
+				while (SDL_PollEvent(&ev)) {
+					switch (ev.type) {
+					case SDL_QUIT:
+						quit = true;
+						break;
+					}
+				}
+			}
+		} catch (std::exception&) {
+			if (emulator.cpu().trace()) {
+				std::ofstream out{TRACE_FILE, std::ios::binary};
+				emulator.cpu().trace()->write(out);
+				std::cerr << "Trace written to " << TRACE_FILE << '\n';
 			}
+			throw;
 		}
 	} catch (std::exception& e) {
 		std::cerr << e.what() << '\n';
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "gdbstub.h"
+
+static const char HEX[] = "0123456789abcdef";
+
+// the largest packet GDB may send or expect, advertised in qSupported
+static const std::size_t PACKET_SIZE = 0x1000;
+
+static void appendByte(std::string& out, BYTE value) {
+	out += HEX[value >> 4];
+	out += HEX[value & 0xf];
+}
+
+// registers are little-endian, like everything else GDB reads from the target
+static void appendWord(std::string& out, WORD value) {
+	appendByte(out, static_cast<BYTE>(value));
+	appendByte(out, static_cast<BYTE>(value >> 8));
+}
+
+static int nibble(char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+// false if the two characters at pos aren't there or aren't hex
+static bool parseByte(const std::string& in, std::size_t pos, BYTE& value) {
+	if (pos + 2 > in.size() || nibble(in[pos]) < 0 || nibble(in[pos + 1]) < 0) {
+		return false;
+	}
+	value = static_cast<BYTE>(nibble(in[pos]) << 4 | nibble(in[pos + 1]));
+	return true;
+}
+
+static bool parseWord(const std::string& in, std::size_t pos, WORD& value) {
+	BYTE low;
+	BYTE high;
+	if (!parseByte(in, pos, low) || !parseByte(in, pos + 2, high)) {
+		return false;
+	}
+	value = static_cast<WORD>(low | high << 8);
+	return true;
+}
+
+// a hex number up to the next non-hex character, pos is left after it
+static DWORD parseNumber(const std::string& in, std::size_t& pos) {
+	DWORD value = 0;
+	for (; pos < in.size() && nibble(in[pos]) >= 0; pos++) {
+		value = value << 4 | static_cast<DWORD>(nibble(in[pos]));
+	}
+	return value;
+}
+
+// in the order of GDB's z80 target
+static std::array<WORD*, 6> registers(CPUState& state) {
+	return {{ &state.af, &state.bc, &state.de, &state.hl, &state.sp, &state.pc }};
+}
+
+GdbStub::GdbStub(IMMU& mmu_, WORD port) :
+	m_mmu{mmu_}
+{
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	if (server < 0) {
+		throw std::runtime_error{"Can't create the GDB socket"};
+	}
+	int reuse = 1;
+	setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(server, static_cast<sockaddr*>(static_cast<void*>(&addr)), sizeof(addr)) < 0 || listen(server, 1) < 0) {
+		close(server);
+		throw std::runtime_error{"Can't listen on the GDB port"};
+	}
+	std::cout << "Waiting for GDB on localhost:" << port << '\n';
+	m_fd = accept(server, nullptr, nullptr);
+	close(server);
+	if (m_fd < 0) {
+		throw std::runtime_error{"GDB didn't connect"};
+	}
+}
+
+GdbStub::~GdbStub() {
+	detach();
+}
+
+void GdbStub::detach() {
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+bool GdbStub::interrupted() {
+	char c = 0;
+	// Ctrl-C is the only thing GDB sends while the program runs
+	return m_fd >= 0 && recv(m_fd, &c, 1, MSG_DONTWAIT) == 1 && c == 0x03;
+}
+
+bool GdbStub::receive(std::string& packet) {
+	packet.clear();
+	char c = 0;
+	// skip acknowledgements (and Ctrl-C, the program is already stopped)
+	do {
+		if (read(m_fd, &c, 1) != 1) {
+			return false;
+		}
+	} while (c != '$');
+	while (read(m_fd, &c, 1) == 1) {
+		if (c == '#') {
+			char checksum[2];
+			if (read(m_fd, checksum, 2) != 2 || write(m_fd, "+", 1) != 1) {
+				return false;
+			}
+			return true;
+		}
+		packet += c;
+	}
+	return false;
+}
+
+void GdbStub::send(const std::string& data) {
+	BYTE checksum = 0;
+	for (char c : data) {
+		checksum = static_cast<BYTE>(checksum + c);
+	}
+	std::string packet = "$" + data + "#";
+	appendByte(packet, checksum);
+	if (write(m_fd, packet.data(), packet.size()) != static_cast<ssize_t>(packet.size())) {
+		detach();
+	}
+}
+
+bool GdbStub::stopped(CPUState& state, Breakpoints& breakpoints) {
+	if (m_fd < 0) {
+		return false;
+	}
+	if (m_running) {
+		// SIGTRAP
+		send("S05");
+		m_running = false;
+	}
+	std::string packet;
+	while (receive(packet)) {
+		std::string reply;
+		switch (handle(packet, state, breakpoints, reply)) {
+		case Action::REPLY:
+			send(reply);
+			break;
+		case Action::CONTINUE:
+			m_running = true;
+			return false;
+		case Action::STEP:
+			m_running = true;
+			return true;
+		case Action::DETACH:
+			detach();
+			break;
+		}
+		if (m_fd < 0) {
+			break;
+		}
+	}
+	// detached or disconnected, the program runs on without breakpoints
+	detach();
+	for (DWORD addr = 0; addr <= 0xffff; addr++) {
+		breakpoints.set(static_cast<WORD>(addr), false);
+	}
+	return false;
+}
+
+GdbStub::Action GdbStub::handle(const std::string& packet, CPUState& state, Breakpoints& breakpoints, std::string& reply) {
+	if (packet.empty()) {
+		return Action::REPLY;
+	}
+	std::size_t pos = 1;
+	switch (packet[0]) {
+	case '?':
+		reply = "S05";
+		break;
+	case 'g':
+		for (WORD* reg : registers(state)) {
+			appendWord(reply, *reg);
+		}
+		break;
+	case 'G': {
+		// all registers or none
+		std::array<WORD, 6> values;
+		for (WORD& value : values) {
+			if (!parseWord(packet, pos, value)) {
+				reply = "E01";
+				return Action::REPLY;
+			}
+			pos += 4;
+		}
+		for (std::size_t i = 0; i < values.size(); i++) {
+			*registers(state)[i] = values[i];
+		}
+		reply = "OK";
+		break;
+	}
+	case 'p': {
+		DWORD index = parseNumber(packet, pos);
+		if (index < registers(state).size()) {
+			appendWord(reply, *registers(state)[index]);
+		} else {
+			reply = "E00";
+		}
+		break;
+	}
+	case 'P': {
+		DWORD index = parseNumber(packet, pos);
+		WORD value;
+		if (index < registers(state).size() && pos < packet.size() && packet[pos] == '=') {
+			if (parseWord(packet, pos + 1, value)) {
+				*registers(state)[index] = value;
+				reply = "OK";
+			} else {
+				reply = "E01";
+			}
+		} else {
+			reply = "E00";
+		}
+		break;
+	}
+	case 'm': {
+		DWORD addr = parseNumber(packet, pos);
+		pos++;
+		DWORD length = parseNumber(packet, pos);
+		// two characters per byte
+		if (length > PACKET_SIZE / 2) {
+			reply = "E01";
+			break;
+		}
+		for (DWORD i = 0; i < length; i++) {
+			appendByte(reply, m_mmu.readByte(static_cast<WORD>(addr + i)));
+		}
+		break;
+	}
+	case 'M': {
+		DWORD addr = parseNumber(packet, pos);
+		pos++;
+		DWORD length = parseNumber(packet, pos);
+		pos++;
+		// all bytes or none
+		if (length > (packet.size() - std::min(pos, packet.size())) / 2) {
+			reply = "E01";
+			break;
+		}
+		std::vector<BYTE> values(length);
+		for (DWORD i = 0; i < length; i++, pos += 2) {
+			if (!parseByte(packet, pos, values[i])) {
+				reply = "E01";
+				return Action::REPLY;
+			}
+		}
+		for (DWORD i = 0; i < length; i++) {
+			m_mmu.writeByte(static_cast<WORD>(addr + i), values[i]);
+		}
+		reply = "OK";
+		break;
+	}
+	case 'Z':
+	case 'z':
+		// software and hardware breakpoints are the same thing here, watchpoints aren't supported
+		if (packet.size() > 2 && (packet[1] == '0' || packet[1] == '1') && packet[2] == ',') {
+			pos = 3;
+			breakpoints.set(static_cast<WORD>(parseNumber(packet, pos)), packet[0] == 'Z');
+			reply = "OK";
+		}
+		break;
+	case 'c':
+	case 's':
+		if (pos < packet.size()) {
+			state.pc = static_cast<WORD>(parseNumber(packet, pos));
+		}
+		return packet[0] == 'c' ? Action::CONTINUE : Action::STEP;
+	case 'D':
+		send("OK");
+		return Action::DETACH;
+	case 'k':
+		return Action::DETACH;
+	case 'H':
+		reply = "OK";
+		break;
+	case 'q':
+		if (packet.compare(0, 10, "qSupported") == 0) {
+			std::ostringstream supported;
+			supported << "PacketSize=" << std::hex << PACKET_SIZE;
+			reply = supported.str();
+		} else if (packet == "qAttached") {
+			reply = "1";
+		} else if (packet == "qC") {
+			reply = "QC1";
+		}
+		break;
+	default:
+		// empty: not supported
+		break;
+	}
+	return Action::REPLY;
+}
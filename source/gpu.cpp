@@ -2,7 +2,7 @@
 #include <iostream>
 #include "gpu.h"
 
-GPU::GPU(Display& display_, InterruptState& intState_) :
+GPU::GPU(IDisplay& display_, InterruptState& intState_) :
 	m_pixelArray{{0}},
 	m_display{display_},
 	m_intState{intState_},
@@ -10,59 +10,83 @@ GPU::GPU(Display& display_, InterruptState& intState_) :
 	m_oam{{0}}
 {
 	(void)m_dma;
-	(void)m_lYC;
 	(void)m_wX;
 }
 
 // See: http://imrannazar.com/GameBoy-Emulation-in-JavaScript:-GPU-Timings
+// Cycles past a mode change are carried over, so callers may hand in whole batches of instructions.
 void GPU::step(DWORD cycles) {
 	m_cycleCount += cycles;
+	if (m_cycleCount >= m_modeLength) {
+		m_cycleCount -= m_modeLength;
+		m_modeLength = endMode();
+	}
+}
 
+DWORD GPU::advance() {
+	m_cycleCount = 0;
+	m_modeLength = endMode();
+	return m_modeLength;
+}
+
+// The mode's cycles have passed: starts the next one and returns its length.
+DWORD GPU::endMode() {
 	switch (m_lcdStat & 0b11) {
 	case ACCESSING_OAM:
-		if (m_cycleCount >= 80) {
-			m_cycleCount = 0;
-			m_lcdStat = (m_lcdStat & 0b11111100) | ACCESSING_VRAM;
-		}
-		break;
+		setMode(ACCESSING_VRAM);
+		return 172;
 	case ACCESSING_VRAM:
-		if (m_cycleCount >= 172) {
-			m_cycleCount = 0;
-			m_lcdStat = (m_lcdStat & 0b11111100) | HBLANK;
-
-			//throw std::runtime_error{"Scanline"};
-			renderScanline();
-		}
-		break;
+		setMode(HBLANK);
+		//throw std::runtime_error{"Scanline"};
+		renderScanline();
+		return 204;
 	case HBLANK:
-		if (m_cycleCount >= 204) {
-			m_cycleCount = 0;
-			m_lY++;
+		setLY(static_cast<BYTE>(m_lY + 1));
 
-			// TODO: 144 or 143???
-			if (m_lY == 144) {
-				m_lcdStat = (m_lcdStat & 0b11111100) | VBLANK;
-				m_intState.vBlank = true;
-				m_display.render(m_pixelArray);
-			} else {
-				m_lcdStat = (m_lcdStat & 0b11111100) | ACCESSING_OAM;
-			}
+		// TODO: 144 or 143???
+		if (m_lY == 144) {
+			setMode(VBLANK);
+			m_intState.request(InterruptState::VBLANK);
+			m_frames++;
+			GB_COUNT(m_counters.frames++);
+			m_display.render(m_pixelArray);
+			return 456;
 		}
-		break;
-	case VBLANK:
-		if (m_cycleCount >= 456) {
-			m_cycleCount = 0;
-			m_lY++;
-
-			if (m_lY > 153) {
-				m_lcdStat = (m_lcdStat & 0b11111100) | ACCESSING_OAM;
-				m_lY = 0;
-			}
+		setMode(ACCESSING_OAM);
+		return 80;
+	default:
+		if (m_lY == 153) {
+			setMode(ACCESSING_OAM);
+			setLY(0);
+			return 80;
 		}
-		break;
+		setLY(static_cast<BYTE>(m_lY + 1));
+		return 456;
+	}
+}
+
+// Mode changes request an LCD STAT interrupt if STAT enables it for the new mode.
+void GPU::setMode(BYTE mode) {
+	GB_COUNT(m_counters.modeChanges++);
+	m_lcdStat = static_cast<BYTE>((m_lcdStat & 0b11111100) | mode);
+	if ((mode == HBLANK && m_hBlankInt) || (mode == VBLANK && m_vBlankInt) || (mode == ACCESSING_OAM && m_oamInt)) {
+		m_intState.request(InterruptState::LCD_STAT);
+	}
+}
+
+// LY reaching LYC requests an LCD STAT interrupt if STAT enables it.
+void GPU::setLY(BYTE lY) {
+	m_lY = lY;
+	m_coincidenceFlag = (m_lY == m_lYC);
+	if (m_coincidenceFlag && m_coincidenceInt) {
+		m_intState.request(InterruptState::LCD_STAT);
 	}
 }
 
+DWORD GPU::cyclesUntilEvent() const {
+	return (m_cycleCount < m_modeLength) ? m_modeLength - m_cycleCount : 1;
+}
+
 void GPU::writeByte(WORD addr, BYTE v) {
 	switch (addr & 0xf000) {
 	case 0x8000:
@@ -86,7 +110,8 @@ void GPU::writeByte(WORD addr, BYTE v) {
 			m_lcdControl = v;
 			return;
 		case LCD_STAT:
-			m_lcdStat = v;
+			// the mode and the coincidence flag are read-only
+			m_lcdStat = static_cast<BYTE>((v & 0b01111000) | (m_lcdStat & 0b00000111));
 			return;
 		case LCD_SCY:
 			m_scY = v;
@@ -98,6 +123,9 @@ void GPU::writeByte(WORD addr, BYTE v) {
 			m_lY = v;
 			return;
 		case LCD_LYC:
+			m_lYC = v;
+			m_coincidenceFlag = (m_lY == m_lYC);
+			return;
 		case LCD_DMA:
 			break;
 		case LCD_BGP:
@@ -151,6 +179,7 @@ BYTE GPU::readByte(WORD addr) {
 		case LCD_LY:
 			return m_lY;
 		case LCD_LYC:
+			return m_lYC;
 		case LCD_DMA:
 			break;
 		case LCD_BGP:
@@ -8,3 +8,14 @@ void IMMU::writeWord(WORD addr, WORD v) {
 	writeByte(addr, static_cast<BYTE>(v));
 	writeByte(addr+1, static_cast<BYTE>(v >> 8));
 }
+
+void IMMU::watchCodePage(BYTE page) {
+	m_watchedPages[page] = true;
+}
+
+std::bitset<256> IMMU::takeChangedCodePages() {
+	auto pages = m_changedPages;
+	m_changedPages.reset();
+	m_codeChanged = false;
+	return pages;
+}
@@ -0,0 +1,459 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "jit.h"
+#include "opcodes.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#define GB_JIT
+#include <sys/mman.h>
+#endif
+
+// Translated blocks are called as DWORD code(CPU* cpu, DWORD budget) (System V ABI) and keep
+//	rbx		CPU*
+//	r12		AF
+//	r13		BC
+//	r14		DE
+//	r15		HL
+//	rbp		SP
+//	[rsp]		cycles so far
+//	[rsp + 4]	budget
+// The registers are written back to the CPU before calling the interpreter and on return.
+//
+// Callouts get (CPU*, opcode | cycles << 8 | offset << 16 | n << 24, nn | pc << 16) and return the
+// cycles taken, or'ed with Jit::EXIT if the block must not go on (see CPU::jitCallout).
+
+namespace {
+
+const std::size_t BUFFER_SIZE = 4 << 20;
+
+enum Reg : BYTE { EAX = 0, ECX = 1, EDX = 2, EBX = 3, ESP = 4, EBP = 5, ESI = 6, EDI = 7, R12 = 12, R13 = 13, R14 = 14, R15 = 15 };
+const BYTE AF = R12, BC = R13, DE = R14, HL = R15, SP = EBP;
+
+// /digit of the group 1 (0x81) and group 2 (0xc1) instructions
+enum Ext : BYTE { ADD = 0, OR = 1, AND = 4, XOR = 6, SHL = 4, SHR = 5 };
+// condition codes
+enum Cond : BYTE { AE = 0x3, B = 0x2, S = 0x8 };
+
+// 8-bit registers in opcode order (B, C, D, E, H, L, (HL), A)
+struct Reg8 {
+	BYTE host;
+	bool high;
+};
+const Reg8 REG8[8] = {{BC, true}, {BC, false}, {DE, true}, {DE, false}, {HL, true}, {HL, false}, {0, false}, {AF, true}};
+// 16-bit registers in opcode order (BC, DE, HL, SP)
+const BYTE REG16[4] = {BC, DE, HL, SP};
+
+class Emitter {
+	public:
+		std::vector<BYTE> code;
+
+		void byte(BYTE v) {
+			code.push_back(v);
+		}
+		void bytes(std::initializer_list<BYTE> v) {
+			code.insert(code.end(), v);
+		}
+		void word(WORD v) {
+			byte(static_cast<BYTE>(v));
+			byte(static_cast<BYTE>(v >> 8));
+		}
+		void dword(DWORD v) {
+			word(static_cast<WORD>(v));
+			word(static_cast<WORD>(v >> 16));
+		}
+		void qword(uint64_t v) {
+			dword(static_cast<DWORD>(v));
+			dword(static_cast<DWORD>(v >> 32));
+		}
+
+		// mov dst, src
+		void mov(BYTE dst, BYTE src) {
+			rex(src, dst);
+			byte(0x89);
+			modrm(3, src, dst);
+		}
+		// mov dst, imm32
+		void movImm(BYTE dst, DWORD imm) {
+			rex(0, dst);
+			byte(static_cast<BYTE>(0xb8 + (dst & 7)));
+			dword(imm);
+		}
+		// add/or/and/xor dst, imm32
+		void aluImm(Ext ext, BYTE dst, DWORD imm) {
+			rex(0, dst);
+			byte(0x81);
+			modrm(3, ext, dst);
+			dword(imm);
+		}
+		// or dst, src
+		void orReg(BYTE dst, BYTE src) {
+			rex(src, dst);
+			byte(0x09);
+			modrm(3, src, dst);
+		}
+		// shl/shr dst, imm8
+		void shift(Ext ext, BYTE dst, BYTE imm) {
+			rex(0, dst);
+			byte(0xc1);
+			modrm(3, ext, dst);
+			byte(imm);
+		}
+		// movzx dst, low byte of src (src must not be 4..7, those would be ah..bh)
+		void movzx8(BYTE dst, BYTE src) {
+			rex(dst, src);
+			bytes({0x0f, 0xb6});
+			modrm(3, dst, src);
+		}
+		// movzx dst, ah
+		void movzxAh(BYTE dst) {
+			bytes({0x0f, 0xb6});
+			modrm(3, dst, 4);
+		}
+		// movzx dst, word [rbx + disp]
+		void load16(BYTE dst, std::ptrdiff_t disp) {
+			rex(dst, 0);
+			bytes({0x0f, 0xb7});
+			modrm(2, dst, EBX);
+			dword(static_cast<DWORD>(disp));
+		}
+		// mov word [rbx + disp], src
+		void store16(std::ptrdiff_t disp, BYTE src) {
+			byte(0x66);
+			rex(src, 0);
+			byte(0x89);
+			modrm(2, src, EBX);
+			dword(static_cast<DWORD>(disp));
+		}
+		// mov word [rbx + disp], imm16
+		void store16Imm(std::ptrdiff_t disp, WORD imm) {
+			bytes({0x66, 0xc7});
+			modrm(2, 0, EBX);
+			dword(static_cast<DWORD>(disp));
+			word(imm);
+		}
+
+		// add qword [rbx + disp], 1
+		void increment(std::ptrdiff_t disp) {
+			bytes({0x48, 0x83});
+			modrm(2, 0, EBX);
+			dword(static_cast<DWORD>(disp));
+			byte(1);
+		}
+
+		// add dword [rsp], imm32
+		void addCycles(DWORD cycles) {
+			bytes({0x81, 0x04, 0x24});
+			dword(cycles);
+		}
+		// mov eax, [rsp]; cmp eax, [rsp + 4]
+		void compareBudget() {
+			bytes({0x8b, 0x04, 0x24, 0x3b, 0x44, 0x24, 0x04});
+		}
+
+		// jcc/jmp rel32 to a label bound later, returns the position of rel32
+		std::size_t jcc(Cond cond) {
+			bytes({0x0f, static_cast<BYTE>(0x80 | cond)});
+			dword(0);
+			return code.size() - 4;
+		}
+		std::size_t jmp() {
+			byte(0xe9);
+			dword(0);
+			return code.size() - 4;
+		}
+		// jcc rel8, to be patched with patch8()
+		std::size_t jcc8(Cond cond) {
+			bytes({static_cast<BYTE>(0x70 | cond), 0});
+			return code.size() - 1;
+		}
+		void bind(std::size_t rel, std::size_t target) {
+			DWORD offset = static_cast<DWORD>(target - (rel + 4));
+			std::memcpy(&code[rel], &offset, sizeof(offset));
+		}
+		void patch8(std::size_t rel) {
+			code[rel] = static_cast<BYTE>(code.size() - (rel + 1));
+		}
+	private:
+		void rex(BYTE reg, BYTE rm) {
+			if (reg >= 8 || rm >= 8) {
+				byte(static_cast<BYTE>(0x40 | ((reg >= 8) << 2) | (rm >= 8)));
+			}
+		}
+		void modrm(BYTE mod, BYTE reg, BYTE rm) {
+			byte(static_cast<BYTE>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+		}
+};
+
+// eax = r
+void load8(Emitter& e, BYTE dst, BYTE r) {
+	const Reg8& reg = REG8[r];
+	if (reg.high) {
+		e.mov(dst, reg.host);
+		e.shift(SHR, dst, 8);
+	} else {
+		e.movzx8(dst, reg.host);
+	}
+}
+
+// r = al, clobbers eax
+void store8(Emitter& e, BYTE r) {
+	const Reg8& reg = REG8[r];
+	e.movzx8(EAX, EAX);
+	if (reg.high) {
+		e.shift(SHL, EAX, 8);
+		e.aluImm(AND, reg.host, 0x00ff);
+	} else {
+		e.aluImm(AND, reg.host, 0xff00);
+	}
+	e.orReg(reg.host, EAX);
+}
+
+// Builds F from the host flags of the last 8-bit operation (ZF, AF and CF line up with Z, H and C),
+// sets the bits in set and keeps the bits of F in keep. Clobbers ah, ecx and edx.
+void flags(Emitter& e, bool z, bool h, bool c, BYTE set, BYTE keep) {
+	e.byte(0x9f); // lahf
+	e.movzxAh(ECX);
+	e.mov(EDX, ECX);
+	e.aluImm(AND, EDX, (z ? 0x40u : 0u) | (h ? 0x10u : 0u));
+	e.shift(SHL, EDX, 1);
+	if (c) {
+		e.aluImm(AND, ECX, 0x01);
+		e.shift(SHL, ECX, 4);
+		e.orReg(EDX, ECX);
+	}
+	if (set != 0) {
+		e.aluImm(OR, EDX, set);
+	}
+	e.aluImm(AND, AF, 0xff00u | keep);
+	e.orReg(AF, EDX);
+}
+
+void translate(Emitter& e, const BlockCache::Op& op) {
+	BYTE opcode = op.opcode;
+	BYTE r = (opcode >> 3) & 7;
+	switch (opcode) {
+	case 0x00:
+		return;
+	case 0x2f: // CPL
+		e.aluImm(XOR, AF, 0xff00);
+		e.aluImm(OR, AF, 0x60);
+		return;
+	case 0x37: // SCF
+		e.aluImm(AND, AF, 0xff9f);
+		e.aluImm(OR, AF, 0x10);
+		return;
+	case 0x3f: // CCF
+		e.aluImm(XOR, AF, 0x10);
+		e.aluImm(AND, AF, 0xff9f);
+		return;
+	default:
+		break;
+	}
+
+	switch (opcode & 0xcf) {
+	case 0x01: // LD rr, nn
+		e.movImm(REG16[opcode >> 4], op.nn);
+		return;
+	case 0x03: // INC rr
+		e.aluImm(ADD, REG16[opcode >> 4], 1);
+		e.aluImm(AND, REG16[opcode >> 4], 0xffff);
+		return;
+	case 0x0b: // DEC rr
+		e.aluImm(ADD, REG16[opcode >> 4], 0xffff);
+		e.aluImm(AND, REG16[opcode >> 4], 0xffff);
+		return;
+	default:
+		break;
+	}
+
+	if (opcode < 0x40) {
+		switch (opcode & 7) {
+		case 4: // INC r
+			load8(e, EAX, r);
+			e.bytes({0xfe, 0xc0}); // inc al
+			flags(e, true, true, false, 0x00, 0x1f);
+			store8(e, r);
+			return;
+		case 5: // DEC r
+			load8(e, EAX, r);
+			e.bytes({0xfe, 0xc8}); // dec al
+			flags(e, true, true, false, 0x40, 0x1f);
+			store8(e, r);
+			return;
+		default: // LD r, n
+			e.movImm(EAX, op.n);
+			store8(e, r);
+			return;
+		}
+	}
+	if (opcode < 0x80) {
+		// LD r, r
+		load8(e, EAX, opcode & 7);
+		store8(e, r);
+		return;
+	}
+
+	// ALU A, r / ALU A, n
+	load8(e, EAX, 7);
+	if (opcode < 0xc0) {
+		load8(e, ECX, opcode & 7);
+	} else {
+		e.movImm(ECX, op.n);
+	}
+	if (r == 1 || r == 3) {
+		e.bytes({0x41, 0x0f, 0xba, 0xe4, 0x04}); // bt r12d, 4 (carry in)
+	}
+	// add/adc/sub/sbb/and/xor/or/cmp al, cl
+	static const BYTE ALU[8] = {0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x38};
+	e.bytes({ALU[r], 0xc8});
+	switch (r) {
+	case 0: case 1: // ADD, ADC
+		flags(e, true, true, true, 0x00, 0x0f);
+		break;
+	case 2: case 3: case 7: // SUB, SBC, CP
+		flags(e, true, true, true, 0x40, 0x0f);
+		break;
+	case 4: // AND
+		flags(e, true, false, false, 0x20, 0x0f);
+		break;
+	default: // XOR, OR
+		flags(e, true, false, false, 0x00, 0x0f);
+		break;
+	}
+	if (r != 7) {
+		store8(e, 7);
+	}
+}
+
+}
+
+bool Jit::available() {
+#ifdef GB_JIT
+	return true;
+#else
+	return false;
+#endif
+}
+
+Jit::Jit(const Layout& layout_) :
+	m_layout(layout_)
+{
+#ifdef GB_JIT
+	void* buffer = mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffer == MAP_FAILED) {
+		throw std::runtime_error{"Can't allocate code buffer"};
+	}
+	m_buffer = static_cast<BYTE*>(buffer);
+#endif
+}
+
+Jit::~Jit() {
+#ifdef GB_JIT
+	munmap(m_buffer, BUFFER_SIZE);
+#endif
+}
+
+void Jit::flush() {
+	m_used = 0;
+}
+
+Jit::Code Jit::compile(WORD start, const BlockCache::Block& block) {
+#ifdef GB_JIT
+	Emitter e;
+	std::vector<std::size_t> exits;
+
+	// push rbx, rbp, r12-r15; sub rsp, 8 (keeps rsp aligned for callouts); mov rbx, rdi
+	e.bytes({0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57, 0x48, 0x83, 0xec, 0x08, 0x48, 0x89, 0xfb});
+	// mov dword [rsp], 0; mov [rsp + 4], esi
+	e.bytes({0xc7, 0x04, 0x24, 0x00, 0x00, 0x00, 0x00, 0x89, 0x74, 0x24, 0x04});
+	auto load = [&]() {
+		e.load16(AF, m_layout.af);
+		e.load16(BC, m_layout.bc);
+		e.load16(DE, m_layout.de);
+		e.load16(HL, m_layout.hl);
+		e.load16(SP, m_layout.sp);
+	};
+	auto store = [&]() {
+		e.store16(m_layout.af, AF);
+		e.store16(m_layout.bc, BC);
+		e.store16(m_layout.de, DE);
+		e.store16(m_layout.hl, HL);
+		e.store16(m_layout.sp, SP);
+	};
+	load();
+
+	WORD pc = start;
+	for (std::size_t i = 0; i < block.ops.size(); i++) {
+		const auto& op = block.ops[i];
+		bool last = (i + 1 == block.ops.size());
+		WORD next = static_cast<WORD>(pc + 1 + op.offset);
+
+		if (registersOnly(op.opcode)) {
+			translate(e, op);
+#ifdef GB_COUNTERS
+			e.increment(m_layout.instructions);
+#endif
+			e.addCycles(op.cycles);
+			if (last) {
+				e.store16Imm(m_layout.pc, next);
+				exits.push_back(e.jmp());
+			} else {
+				e.compareBudget();
+				std::size_t skip = e.jcc8(B);
+				e.store16Imm(m_layout.pc, next);
+				exits.push_back(e.jmp());
+				e.patch8(skip);
+			}
+		} else {
+			store();
+			e.bytes({0x48, 0x89, 0xdf}); // mov rdi, rbx
+			e.byte(0xbe); // mov esi, imm32
+			e.dword(op.opcode | static_cast<DWORD>(op.cycles) << 8 | static_cast<DWORD>(op.offset) << 16 | static_cast<DWORD>(op.n) << 24);
+			e.byte(0xba); // mov edx, imm32
+			e.dword(op.nn | static_cast<DWORD>(pc) << 16);
+			e.bytes({0x48, 0xb8}); // mov rax, imm64
+			e.qword(reinterpret_cast<uint64_t>(m_layout.callout));
+			e.bytes({0xff, 0xd0}); // call rax
+			load();
+			// movzx ecx, ax; add [rsp], ecx; test eax, eax
+			e.bytes({0x0f, 0xb7, 0xc8, 0x01, 0x0c, 0x24, 0x85, 0xc0});
+			exits.push_back(e.jcc(S));
+			if (last) {
+				exits.push_back(e.jmp());
+			} else {
+				e.compareBudget();
+				exits.push_back(e.jcc(AE));
+			}
+		}
+		pc = next;
+	}
+
+	for (auto rel : exits) {
+		e.bind(rel, e.code.size());
+	}
+	store();
+	// mov eax, [rsp]; add rsp, 8; pop r15-r12, rbp, rbx; ret
+	e.bytes({0x8b, 0x04, 0x24, 0x48, 0x83, 0xc4, 0x08, 0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5d, 0x5b, 0xc3});
+
+	if (m_used + e.code.size() > BUFFER_SIZE) {
+		return nullptr;
+	}
+	// the buffer is writable or executable, never both
+	BYTE* code = m_buffer + m_used;
+	mprotect(m_buffer, BUFFER_SIZE, PROT_READ | PROT_WRITE);
+	std::memcpy(code, e.code.data(), e.code.size());
+	mprotect(m_buffer, BUFFER_SIZE, PROT_READ | PROT_EXEC);
+	// keep entry points 16-byte aligned
+	m_used += (e.code.size() + 15) & ~static_cast<std::size_t>(15);
+
+	Code entry;
+	static_assert(sizeof(entry) == sizeof(code), "Function and data pointers differ in size");
+	std::memcpy(&entry, &code, sizeof(entry));
+	return entry;
+#else
+	(void)start;
+	(void)block;
+	return nullptr;
+#endif
+}
@@ -28,9 +28,10 @@ MMU::MMU(std::unique_ptr<Mapper>&& mapper_, GPU& gpu_, InterruptState& intState_
 {
 }
 
-BYTE MMU::readByte(WORD addr) {
+BYTE MMU::readOther(WORD addr) {
 	if (addr <= 0x7fff) {
 		// ROM and BIOS
+		GB_COUNT(m_counters.reads[Counters::ROM]++);
 		if (biosMode && addr < 0x100) {
 			return bios[addr];
 		} else {
@@ -38,6 +39,7 @@ BYTE MMU::readByte(WORD addr) {
 		}
 	} else if (0x8000 <= addr && addr <= 0x9fff) {
 		// Video RAM
+		GB_COUNT(m_counters.reads[Counters::VRAM]++);
 		return gpu.readByte(addr);
 	} else if (0xa000 <= addr && addr <= 0xbfff) {
 		// Cartridge RAM
@@ -53,6 +55,7 @@ BYTE MMU::readByte(WORD addr) {
 		throw std::runtime_error{"Read from ERAM"};
 	} else if (0xfe00 <= addr && addr <= 0xfe9f) {
 		// Object Attribute Memory
+		GB_COUNT(m_counters.reads[Counters::OAM]++);
 		return gpu.readByte(addr);
 	} else if (0xfea0 <= addr && addr <= 0xfeff) {
 		// Not usable
@@ -60,11 +63,12 @@ BYTE MMU::readByte(WORD addr) {
 		return 0xff;
 	} else if (0xff00 <= addr && addr <= 0xff7f) {
 		// IO registers
+		GB_COUNT(m_counters.reads[Counters::IO]++);
 		switch (addr & 0x00f0) {
 		case 0x0000:
 			switch (addr) {
 			case 0xff0f:
-				return intState.intFlag;
+				return intState.intFlag();
 			default:
 				return 0x00;
 			}
@@ -95,17 +99,21 @@ BYTE MMU::readByte(WORD addr) {
 		// High RAM
 		return hram[addr - 0xff80];
 	} else /* 0xffff */ {
-		return intState.intEnable;
+		GB_COUNT(m_counters.reads[Counters::IO]++);
+		return intState.intEnable();
 	}
 	// TODO:
 	//return mapper->readByte(addr);
 }
 
-void MMU::writeByte(WORD addr, BYTE v) {
+void MMU::writeOther(WORD addr, BYTE v) {
 	if (addr <= 0x7fff) {
+		GB_COUNT(m_counters.writes[Counters::ROM]++);
 		mapper->writeByte(addr, v);
+		bankWritten(mapper->romBank(), mapper->bankGeneration());
 	} else if (0x8000 <= addr && addr <= 0x9fff) {
 		// Video RAM
+		GB_COUNT(m_counters.writes[Counters::VRAM]++);
 		gpu.writeByte(addr, v);
 	} else if (0xa000 <= addr && addr <= 0xbfff) {
 		// Cartridge RAM
@@ -113,14 +121,17 @@ void MMU::writeByte(WORD addr, BYTE v) {
 	} else if (0xc000 <= addr && addr <= 0xcfff) {
 		// Work RAM (0)
 		wram0[addr - 0xc000] = v;
+		changed(addr);
 	} else if (0xd000 <= addr && addr <= 0xdfff) {
 		// Work RAM (1)
 		wram1[addr - 0xd000] = v;
+		changed(addr);
 	} else if (0xe000 <= addr && addr <= 0xfdff) {
 		// Echo RAM
 		throw std::runtime_error{"Write to ERAM"};
 	} else if (0xfe00 <= addr && addr <= 0xfe9f) {
 		// Object Attribute Memory
+		GB_COUNT(m_counters.writes[Counters::OAM]++);
 		gpu.writeByte(addr, v);
 	} else if (0xfea0 <= addr && addr <= 0xfeff) {
 		// Not usable
@@ -128,12 +139,13 @@ void MMU::writeByte(WORD addr, BYTE v) {
 		return;
 	} else if (0xff00 <= addr && addr <= 0xff7f) {
 		// IO registers
+		GB_COUNT(m_counters.writes[Counters::IO]++);
 		switch (addr & 0x00f0) {
 		case 0x0000:
 			// Serial, Timer, interrupt
 			switch (addr) {
 			case 0xff0f:
-				intState.intFlag = v;
+				intState.setIntFlag(v);
 				return;
 			case 0xff7f:
 				// off by one error? https://www.reddit.com/r/EmuDev/comments/5nixai/gb_tetris_writing_to_unused_memory/
@@ -150,6 +162,7 @@ void MMU::writeByte(WORD addr, BYTE v) {
 			// video
 			if (addr == 0xff46) {
 				// DMA transfer
+				GB_COUNT(m_counters.dmaTransfers++);
 				for (WORD i = 0; i < 0xa0; i++) {
 					writeByte(static_cast<WORD>(0xfe00 + i), readByte(static_cast<WORD>((v << 8) + i)));
 				}
@@ -160,7 +173,9 @@ void MMU::writeByte(WORD addr, BYTE v) {
 			return;
 		case 0x0050:
 			if (addr == 0xff50) {
+				// the cartridge replaces the BIOS at 0x0000-0x00ff
 				biosMode = false;
+				changed(0x0000);
 				return;
 			}
 		case 0x0060:
@@ -183,8 +198,10 @@ void MMU::writeByte(WORD addr, BYTE v) {
 	} else if (0xff80 <= addr && addr <= 0xfffe) {
 		// High RAM
 		hram[addr - 0xff80] = v;
+		changed(addr);
 		return;
 	} else /* 0xffff */ {
-		intState.intEnable = v;
+		GB_COUNT(m_counters.writes[Counters::IO]++);
+		intState.setIntEnable(v);
 	}
 }
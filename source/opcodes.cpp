@@ -0,0 +1,33 @@
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+
+#include "opcodes.h"
+
+std::string disassemble(BYTE opcode, BYTE n, WORD nn) {
+	if (opcode == 0xcb) {
+		return CB_OPCODES[n].mnemonic;
+	}
+	const char* mnemonic = OPCODES[opcode].mnemonic;
+	if (mnemonic == nullptr) {
+		std::ostringstream out;
+		out << "DB 0x" << std::hex << std::setfill('0') << std::setw(2) << +opcode;
+		return out.str();
+	}
+
+	// replace the operand placeholder (nn, n or N) with its value
+	std::ostringstream out;
+	out << std::hex << std::setfill('0');
+	for (const char* c = mnemonic; *c != '\0'; c++) {
+		bool wordStart = (c == mnemonic) || !std::isalnum(static_cast<unsigned char>(c[-1]));
+		if (wordStart && c[0] == 'n' && c[1] == 'n' && !std::isalnum(static_cast<unsigned char>(c[2]))) {
+			out << "0x" << std::setw(4) << +nn;
+			c++;
+		} else if (wordStart && (c[0] == 'n' || c[0] == 'N') && !std::isalnum(static_cast<unsigned char>(c[1]))) {
+			out << "0x" << std::setw(2) << +n;
+		} else {
+			out << *c;
+		}
+	}
+	return out.str();
+}
@@ -0,0 +1,127 @@
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "profiler.h"
+
+// as in bank:address, e.g. 01:4000
+static std::string name(Profiler::Location location) {
+	std::ostringstream out;
+	out << std::hex << std::setfill('0') << std::setw(2) << (location >> 16) << ':' << std::setw(4) << (location & 0xffff);
+	return out.str();
+}
+
+Profiler::Profiler(Location entry) :
+	m_nodes{{0, entry, 0, 1, {}}},
+	m_stack{{0, 0}}
+{
+}
+
+void Profiler::instruction(Location location, DWORD cycles) {
+	Node& node = m_nodes[m_stack.back().node];
+	node.self.instructions++;
+	node.self.cycles += cycles;
+
+	Cost& cost = m_costs[static_cast<uint64_t>(node.function) << 32 | location];
+	cost.instructions++;
+	cost.cycles += cycles;
+}
+
+void Profiler::call(Location function, WORD site, WORD returnAddr) {
+	if (m_stack.size() >= MAX_DEPTH) {
+		return;
+	}
+	std::size_t parent = m_stack.back().node;
+	auto key = std::make_tuple(parent, site, function);
+	auto child = m_children.find(key);
+	if (child == m_children.end()) {
+		child = m_children.emplace(key, m_nodes.size()).first;
+		m_nodes.push_back({parent, function, site, 0, {}});
+	}
+	m_nodes[child->second].calls++;
+	m_stack.push_back({child->second, returnAddr});
+}
+
+void Profiler::ret(WORD addr) {
+	// the root frame is never left
+	for (std::size_t i = m_stack.size(); i-- > 1;) {
+		if (m_stack[i].returnAddr == addr) {
+			m_stack.resize(i);
+			return;
+		}
+	}
+}
+
+Profiler::Cost Profiler::at(Location location) const {
+	Cost total{};
+	for (const auto& cost : m_costs) {
+		if ((cost.first & 0xffffffff) == location) {
+			total.instructions += cost.second.instructions;
+			total.cycles += cost.second.cycles;
+		}
+	}
+	return total;
+}
+
+std::vector<Profiler::Cost> Profiler::inclusive() const {
+	std::vector<Cost> costs(m_nodes.size());
+	// children are always created after their parent
+	for (std::size_t i = m_nodes.size(); i-- > 0;) {
+		costs[i].instructions += m_nodes[i].self.instructions;
+		costs[i].cycles += m_nodes[i].self.cycles;
+		if (i != 0) {
+			costs[m_nodes[i].parent].instructions += costs[i].instructions;
+			costs[m_nodes[i].parent].cycles += costs[i].cycles;
+		}
+	}
+	return costs;
+}
+
+void Profiler::writeCallgrind(std::ostream& out) const {
+	struct Call {
+		uint64_t calls = 0;
+		Cost inclusive;
+	};
+	// sorted by function, then by location
+	std::map<Location, std::map<Location, Cost>> lines;
+	std::map<Location, std::map<std::pair<WORD, Location>, Call>> calls;
+	for (const auto& cost : m_costs) {
+		lines[static_cast<Location>(cost.first >> 32)][static_cast<Location>(cost.first)] = cost.second;
+	}
+	auto costs = inclusive();
+	for (std::size_t i = 1; i < m_nodes.size(); i++) {
+		const Node& node = m_nodes[i];
+		Call& call = calls[m_nodes[node.parent].function][std::make_pair(node.site, node.function)];
+		call.calls += node.calls;
+		call.inclusive.instructions += costs[i].instructions;
+		call.inclusive.cycles += costs[i].cycles;
+	}
+
+	out << "version: 1\ncreator: gb\npositions: instr\nevents: Instructions Cycles\n";
+	for (const auto& function : lines) {
+		out << "\nfn=" << name(function.first) << '\n';
+		for (const auto& line : function.second) {
+			out << "0x" << std::hex << (line.first & 0xffff) << std::dec << ' ' << line.second.instructions << ' ' << line.second.cycles << '\n';
+		}
+		for (const auto& call : calls[function.first]) {
+			out << "cfn=" << name(call.first.second) << '\n';
+			out << "calls=" << call.second.calls << " 0x" << std::hex << (call.first.second & 0xffff) << '\n';
+			out << "0x" << call.first.first << std::dec << ' ' << call.second.inclusive.instructions << ' ' << call.second.inclusive.cycles << '\n';
+		}
+	}
+}
+
+void Profiler::writeFolded(std::ostream& out) const {
+	for (std::size_t i = 0; i < m_nodes.size(); i++) {
+		if (m_nodes[i].self.cycles == 0) {
+			continue;
+		}
+		std::string stack = name(m_nodes[i].function);
+		for (std::size_t node = i; node != 0;) {
+			node = m_nodes[node].parent;
+			stack = name(m_nodes[node].function) + ';' + stack;
+		}
+		out << stack << ' ' << m_nodes[i].self.cycles << '\n';
+	}
+}
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "opcodes.h"
+#include "trace.h"
+
+static const char MAGIC[8] = {'G', 'B', 'T', 'R', 'A', 'C', 'E', '1'};
+
+Trace::Trace(std::size_t capacity) {
+	std::size_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	m_entries.resize(size);
+	m_mask = size - 1;
+}
+
+Trace::Header Trace::header() const noexcept {
+	Header h{};
+	std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+	h.entrySize = sizeof(TraceEntry);
+	h.count = static_cast<uint32_t>(std::min<uint64_t>(m_next, m_entries.size()));
+	return h;
+}
+
+std::size_t Trace::first() const noexcept {
+	return m_next <= m_entries.size() ? 0 : static_cast<std::size_t>(m_next & m_mask);
+}
+
+std::vector<TraceEntry> Trace::entries() const {
+	std::vector<TraceEntry> result;
+	std::size_t count = header().count;
+	result.reserve(count);
+	for (std::size_t i = 0; i < count; i++) {
+		result.push_back(m_entries[(first() + i) & m_mask]);
+	}
+	return result;
+}
+
+void Trace::write(std::ostream& out) const {
+	Header h = header();
+	out.write(static_cast<const char*>(static_cast<const void*>(&h)), sizeof(h));
+	for (const auto& entry : entries()) {
+		out.write(static_cast<const char*>(static_cast<const void*>(&entry)), sizeof(entry));
+	}
+}
+
+// writes everything or fails, write(2) may stop early
+static bool writeAll(int fd, const void* data, std::size_t size) noexcept {
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0) {
+		ssize_t written = ::write(fd, bytes, size);
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		size -= static_cast<std::size_t>(written);
+	}
+	return true;
+}
+
+bool Trace::dump(int fd) const noexcept {
+	Header h = header();
+	// the oldest entries up to the end of the buffer, then the rest from its start
+	std::size_t start = first();
+	std::size_t tail = std::min<std::size_t>(h.count, m_entries.size() - start);
+	return writeAll(fd, &h, sizeof(h))
+		&& writeAll(fd, m_entries.data() + start, tail * sizeof(TraceEntry))
+		&& writeAll(fd, m_entries.data(), (h.count - tail) * sizeof(TraceEntry));
+}
+
+std::vector<TraceEntry> Trace::read(std::istream& in) {
+	Header h{};
+	in.read(static_cast<char*>(static_cast<void*>(&h)), sizeof(h));
+	if (!in || std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.entrySize != sizeof(TraceEntry)) {
+		throw std::runtime_error{"Not a trace"};
+	}
+	std::vector<TraceEntry> entries(h.count);
+	in.read(static_cast<char*>(static_cast<void*>(entries.data())), static_cast<std::streamsize>(h.count * sizeof(TraceEntry)));
+	if (!in) {
+		throw std::runtime_error{"Truncated trace"};
+	}
+	return entries;
+}
+
+std::string Trace::format(const TraceEntry& entry) {
+	// missing opcodes have no length, they are shown as one byte
+	std::size_t length = std::max<std::size_t>(OPCODES[entry.opcode].length, 1);
+	std::ostringstream bytes;
+	bytes << std::hex << std::setfill('0') << std::setw(2) << +entry.opcode;
+	for (std::size_t i = 1; i < length; i++) {
+		bytes << ' ' << std::setw(2) << +entry.operands[i - 1];
+	}
+	WORD nn = static_cast<WORD>(entry.operands[0] | entry.operands[1] << 8);
+
+	std::ostringstream out;
+	out << std::setw(12) << entry.stamp << "  " << std::hex << std::setfill('0') << std::setw(4) << entry.pc << "  ";
+	out << std::setfill(' ') << std::left << std::setw(10) << bytes.str() << std::setw(18) << disassemble(entry.opcode, entry.operands[0], nn) << std::right;
+	out << std::setfill('0');
+	out << "AF=" << std::setw(4) << entry.af << " BC=" << std::setw(4) << entry.bc << " DE=" << std::setw(4) << entry.de;
+	out << " HL=" << std::setw(4) << entry.hl << " SP=" << std::setw(4) << entry.sp;
+	return out.str();
+}
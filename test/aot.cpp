@@ -0,0 +1,115 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "aot.h"
+#include "codemap.h"
+#include "cpuimpl.h"
+#include "emulator.h"
+#include "romonly.h"
+
+namespace {
+class FrameDisplay : public IDisplay {
+	public:
+		void render(PixelArray& pixels) override {
+			last = pixels;
+		}
+		PixelArray last{{0}};
+};
+
+// boots into a loop at 0x0150 that adds to A and B and stores B in 0xc000
+std::vector<BYTE> loopRom() {
+	static const std::array<BYTE, 48> logo{{
+		0xce, 0xed, 0x66, 0x66, 0xcc, 0x0d, 0x00, 0x0b, 0x03, 0x73, 0x00, 0x83,
+		0x00, 0x0c, 0x00, 0x0d, 0x00, 0x08, 0x11, 0x1f, 0x88, 0x89, 0x00, 0x0e,
+		0xdc, 0xcc, 0x6e, 0xe6, 0xdd, 0xdd, 0xd9, 0x99, 0xbb, 0xbb, 0x67, 0x63,
+		0x6e, 0x0e, 0xec, 0xcc, 0xdd, 0xdc, 0x99, 0x9f, 0xbb, 0xb9, 0x33, 0x3e,
+	}};
+	const std::array<BYTE, 9> loop{{
+		0xc6, 0x03,		// 0x0150: ADD A, 3
+		0x80,			// ADD A, B
+		0x47,			// LD B, A
+		0xea, 0x00, 0xc0,	// LD (0xc000), A
+		0x18, 0xf7,		// JR 0x0150
+	}};
+	std::vector<BYTE> rom(0x8000, 0);
+	// 0x0100: JP 0x0150
+	rom[0x100] = 0xc3;
+	rom[0x101] = 0x50;
+	rom[0x102] = 0x01;
+	std::copy(logo.begin(), logo.end(), rom.begin() + 0x104);
+	rom[0x14d] = 0xe7;
+	std::copy(loop.begin(), loop.end(), rom.begin() + 0x150);
+	return rom;
+}
+
+// what gb-aot writes for the loop
+int calls = 0;
+const BYTE loopBytes[] = { 0xc6, 0x03, 0x80, 0x47, 0xea, 0x00, 0xc0, 0x18, 0xf7 };
+DWORD loopBlock(void* self, DWORD budget) {
+	calls++;
+	auto& cpu = *static_cast<BasicCPU<MMU>*>(self);
+	DWORD total = 0;
+	if (!cpu.runAot<0xc6>(0x03, 0x0000, total, budget)) return total;
+	if (!cpu.runAot<0x80>(0x00, 0x0000, total, budget)) return total;
+	if (!cpu.runAot<0x47>(0x00, 0x0000, total, budget)) return total;
+	if (!cpu.runAot<0xea>(0x00, 0xc000, total, budget)) return total;
+	if (!cpu.runAot<0x18>(0xf7, 0x0000, total, budget)) return total;
+	return total;
+}
+const AotBlock loopBlocks[] = {
+	{ 0x00, 0x0150, loopBytes, sizeof(loopBytes), loopBlock },
+};
+const AotProgram loopProgram{0x0000, loopBlocks, 1};
+}
+
+SCENARIO("gb-aot should translate every block of the code map into a function", "[aot]") {
+	GIVEN("a ROM with a loop at 0x0150") {
+		RomOnly rom{loopRom()};
+		CodeMap map = CodeMap::discover(rom);
+
+		WHEN("writing its translation") {
+			std::ostringstream out;
+			writeAot(out, rom, map, "loop.gb");
+			std::string code = out.str();
+
+			THEN("the loop is one function with one call per instruction, found by the ROM's checksum") {
+				REQUIRE(code.find("// Written by gb-aot from loop.gb") == 0);
+				REQUIRE(code.find("const BYTE bytes_00_0150[] = { 0xc6, 0x03, 0x80, 0x47, 0xea, 0x00, 0xc0, 0x18, 0xf7 };") != std::string::npos);
+				REQUIRE(code.find("DWORD block_00_0150(void* self, DWORD budget) {") != std::string::npos);
+				REQUIRE(code.find("\tif (!cpu.runAot<0xc6>(0x03, 0x0000, total, budget)) return total; // 0x0150: ADD A, 0x03\n") != std::string::npos);
+				REQUIRE(code.find("\tif (!cpu.runAot<0xea>(0x00, 0xc000, total, budget)) return total; // 0x0154: LD (0xc000), A\n") != std::string::npos);
+				REQUIRE(code.find("\t{ 0x00, 0x0150, bytes_00_0150, 9, block_00_0150 },\n") != std::string::npos);
+				REQUIRE(code.find("const AotProgram program{0x0000, blocks, sizeof(blocks) / sizeof(blocks[0])};") != std::string::npos);
+			}
+		}
+	}
+}
+
+SCENARIO("Translated code should render the same frames as the cached engine", "[aot]") {
+	GIVEN("the loop ROM with and without its translation") {
+		FrameDisplay plainDisplay;
+		FrameDisplay aotDisplay;
+		Emulator plain{std::unique_ptr<Mapper>{new RomOnly{loopRom()}}, plainDisplay, CPU::Engine::Cached};
+		Emulator translated{std::unique_ptr<Mapper>{new RomOnly{loopRom()}}, aotDisplay, CPU::Engine::Cached};
+		translated.cpu().setAot(&loopProgram);
+		calls = 0;
+
+		WHEN("running 420 frames, past the boot ROM") {
+			THEN("every frame, the cycle count and memory are identical, and the loop ran translated") {
+				for (int frame = 0; frame < 420; frame++) {
+					auto plainSummary = plain.runFrame();
+					auto aotSummary = translated.runFrame();
+
+					INFO("frame " << frame);
+					REQUIRE(plainSummary.cycles == aotSummary.cycles);
+					REQUIRE(plainDisplay.last == aotDisplay.last);
+				}
+				REQUIRE(plain.mmu().readByte(0xc000) == translated.mmu().readByte(0xc000));
+				REQUIRE(plain.snapshot().af == translated.snapshot().af);
+				REQUIRE(calls > 1000);
+			}
+		}
+	}
+}
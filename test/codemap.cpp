@@ -0,0 +1,59 @@
+#include <sstream>
+#include <vector>
+
+#include "catch.hpp"
+#include "codemap.h"
+#include "romonly.h"
+
+SCENARIO("Code discovery should follow jumps, calls and returns from the entry points", "[codemap]") {
+	GIVEN("a ROM with data between its routines") {
+		std::vector<BYTE> bytes(0x8000, 0xd3);
+		std::vector<BYTE> entry{
+			0xc3, 0x50, 0x01,	// 0x0100: JP 0x0150
+			0xce, 0xed,		// 0x0103: data
+		};
+		std::vector<BYTE> main{
+			0xcd, 0x00, 0x02,	// 0x0150: CALL 0x0200
+			0x20, 0xfb,		// 0x0153: JR NZ, 0x0150
+			0xe9,			// 0x0155: JP HL
+			0x12, 0x34,		// 0x0156: data
+		};
+		std::vector<BYTE> routine{
+			0xc8,			// 0x0200: RET Z
+			0x3c,			// 0x0201: INC A
+			0xc9,			// 0x0202: RET
+			0x00,			// 0x0203: data
+		};
+		std::copy(entry.begin(), entry.end(), bytes.begin() + 0x100);
+		std::copy(main.begin(), main.end(), bytes.begin() + 0x150);
+		std::copy(routine.begin(), routine.end(), bytes.begin() + 0x200);
+		RomOnly rom{std::move(bytes)};
+
+		WHEN("discovering the code") {
+			CodeMap map = CodeMap::discover(rom);
+
+			THEN("instructions, operands, labels and block starts are marked, data isn't") {
+				REQUIRE(map.flags(0x0100) == (CodeMap::CODE | CodeMap::BLOCK | CodeMap::ENTRY));
+				REQUIRE(map.flags(0x0101) == CodeMap::OPERAND);
+				REQUIRE(map.flags(0x0103) == 0);
+				REQUIRE(map.flags(0x0150) == (CodeMap::CODE | CodeMap::LABEL | CodeMap::BLOCK));
+				REQUIRE(map.code(0x0153));
+				REQUIRE(map.code(0x0155));
+				REQUIRE(!map.code(0x0156));
+				REQUIRE(map.flags(0x0200) == (CodeMap::CODE | CodeMap::LABEL | CodeMap::BLOCK));
+				REQUIRE(map.code(0x0202));
+				REQUIRE(!map.code(0x0203));
+				// the RST vectors hold a missing opcode
+				REQUIRE(map.flags(0x0008) == (CodeMap::ENTRY | CodeMap::BLOCK));
+				REQUIRE(map.blocks() == (std::vector<WORD>{ 0x0100, 0x0150, 0x0153, 0x0155, 0x0200, 0x0201 }));
+			}
+
+			THEN("the map survives writing and reading") {
+				std::stringstream file;
+				map.write(file);
+				CodeMap read = CodeMap::read(file);
+				REQUIRE(read.blocks() == map.blocks());
+			}
+		}
+	}
+}
@@ -1,30 +1,72 @@
+#include <memory>
+#include <random>
+#include <sstream>
+#include <vector>
+
 #include "catch.hpp"
-#include "cpu.h"
+#include "cpuimpl.h"
+#include "opcodes.h"
 #include "romonly.h"
 #include "mmu.h"
 #include "interruptstate.h"
 
 static InterruptState intState_{};
 
-class TestCPU : public CPU {
+class TestMMU final : public IMMU {
 	public:
-		TestCPU(IMMU& mmu_) : CPU{mmu_, intState_} {
+		TestMMU(std::array<BYTE, 0x10000>& data_) : data{data_} {}
+
+		BYTE readByte(WORD addr) override {
+			return data[addr];
+		}
+
+		void writeByte(WORD addr, BYTE v) override {
+			data[addr] = v;
+			changed(addr);
+		}
+
+		std::array<BYTE, 0x10000>& data;
+};
+
+class TestCPU : public BasicCPU<TestMMU> {
+	public:
+		TestCPU(TestMMU& mmu_, Engine engine_ = Engine::Table) : BasicCPU{mmu_, intState_, engine_} {
+		}
+
+		bool hasInstruction(BYTE op) {
+			return m_instructions[op].opcode == op;
+		}
+
+		bool translated(WORD addr) {
+			auto block = m_blockCache.find(m_mmu.codeBank(addr), addr);
+			return block != nullptr && block->code != nullptr;
+		}
+
+		// af, bc, de, hl, sp, pc
+		std::array<WORD, 6> getRegisters() {
+			materializeFlags();
+			return {{ m_state.af, m_state.bc, m_state.de, m_state.hl, m_state.sp, m_state.pc }};
+		}
+
+		void setRegisters(const std::array<WORD, 6>& r) {
+			m_state.af = r[0];
+			m_state.bc = r[1];
+			m_state.de = r[2];
+			m_state.hl = r[3];
+			m_state.sp = r[4];
+			m_state.pc = r[5];
 		}
 
 		void call(BYTE op) {
-			for (auto& in : m_instructions) {
-				if (in.opcode == op) {
-					in.f();
-				}
-			}
+			m_instructions[op].f();
 		}
 
 		void setBC(WORD bc_) {
-			m_bc = bc_;
+			m_state.bc = bc_;
 		}
 
 		WORD getBC() {
-			return m_bc;
+			return m_state.bc;
 		}
 
 		void setNN(WORD nn_) {
@@ -36,83 +78,78 @@ class TestCPU : public CPU {
 		}
 
 		void setB(BYTE b_) {
-			b = b_;
+			b() = b_;
 		}
 
 		BYTE getB() {
-			return b;
+			return b();
 		}
 
 		void setA(BYTE a_) {
-			a = a_;
+			a() = a_;
 		}
 
 		BYTE getA() {
-			return a;
+			return a();
 		}
 
 		void setC(BYTE c_) {
-			c = c_;
+			c() = c_;
 		}
 
 		BYTE getC() {
-			return c;
+			return c();
 		}
 
 		void setHL(WORD hl_) {
-			m_hl = hl_;
+			m_state.hl = hl_;
 		}
 
 		WORD getHL() {
-			return m_hl;
+			return m_state.hl;
 		}
 
 		void setSP(WORD sp_) {
-			m_sp = sp_;
+			m_state.sp = sp_;
 		}
 
 		WORD getSP() {
-			return m_sp;
+			return m_state.sp;
 		}
 
-		void setPC(WORD pc_) {
-			m_pc = pc_;
-		}
-
-		WORD getPC() {
-			return m_pc;
+		void setIME(bool ime_) {
+			m_state.ime = ime_;
 		}
 
-		auto getCarry() -> decltype(m_carryFlag)& {
-			return m_carryFlag;
+		void setPC(WORD pc_) {
+			m_state.pc = pc_;
 		}
 
-		auto getHalf() -> decltype(m_halfFlag)& {
-			return m_halfFlag;
+		WORD getPC() {
+			return m_state.pc;
 		}
 
-		auto getZero() -> decltype(m_zeroFlag)& {
-			return m_zeroFlag;
+		BitRef<BYTE, 4> getCarry() {
+			return carryFlag();
 		}
 
-		auto getNeg() -> decltype(m_negFlag)& {
-			return m_negFlag;
+		BitRef<BYTE, 5> getHalf() {
+			return halfFlag();
 		}
-};
-
-class TestMMU : public IMMU {
-	public:
-		TestMMU(std::array<BYTE, 0x10000>& data_) : data{data_} {}
 
-		BYTE readByte(WORD addr) override {
-			return data[addr];
+		BitRef<BYTE, 7> getZero() {
+			return zeroFlag();
 		}
 
-		void writeByte(WORD addr, BYTE v) override {
-			data[addr] = v;
+		BitRef<BYTE, 6> getNeg() {
+			return negFlag();
 		}
 
-		std::array<BYTE, 0x10000>& data;
+#ifdef GB_ALU_TABLES
+		using CPUBase::addTable;
+		using CPUBase::subTable;
+		using CPUBase::daaTable;
+#endif
 };
 
 SCENARIO("WORD registers should have correct endianness", "[cpu]") {
@@ -1043,6 +1080,53 @@ SCENARIO("Testing DAA instruction", "[cpu]") {
 	}
 }
 
+#ifdef GB_ALU_TABLES
+SCENARIO("The arithmetic tables should match the computed results", "[cpu]") {
+	GIVEN("the tables of the ALU_TABLES build") {
+		WHEN("looking up ADC and SBC for every A, operand and carry") {
+			THEN("result and flags are those of the arithmetic") {
+				for (unsigned a = 0; a < 0x100; a++) {
+					for (unsigned operand = 0; operand < 0x100; operand++) {
+						for (unsigned carry = 0; carry < 2; carry++) {
+							unsigned sum = a + operand + carry;
+							unsigned sumFlags = ((sum & 0xff) == 0 ? FLAG_Z : 0) |
+								((a & 0xf) + (operand & 0xf) + carry > 0xf ? FLAG_H : 0) |
+								(sum > 0xff ? FLAG_C : 0);
+							int difference = static_cast<int>(a) - static_cast<int>(operand) - static_cast<int>(carry);
+							unsigned differenceFlags = ((difference & 0xff) == 0 ? FLAG_Z : 0) | FLAG_N |
+								((a & 0xf) < (operand & 0xf) + carry ? FLAG_H : 0) |
+								(difference < 0 ? FLAG_C : 0);
+
+							INFO("A 0x" << std::hex << a << ", operand 0x" << operand << ", carry " << carry);
+							REQUIRE(TestCPU::addTable(static_cast<BYTE>(a), static_cast<BYTE>(operand), carry != 0) == ((sum & 0xff) << 8 | sumFlags));
+							REQUIRE(TestCPU::subTable(static_cast<BYTE>(a), static_cast<BYTE>(operand), carry != 0) == ((difference & 0xff) << 8 | differenceFlags));
+						}
+					}
+				}
+			}
+		}
+		WHEN("looking up DAA for every A and every N, H and C") {
+			THEN("result and flags are those of the correction") {
+				for (unsigned a = 0; a < 0x100; a++) {
+					for (unsigned flags = 0; flags < 0x80; flags += 0x10) {
+						bool negative = (flags & FLAG_N) != 0;
+						bool half = (flags & FLAG_H) != 0;
+						bool carry = (flags & FLAG_C) != 0;
+						unsigned correction = (a > 0x99 || carry ? 0x60 : 0) | ((a & 0xf) > 0x9 || half ? 0x06 : 0);
+						unsigned result = (negative ? a - correction : a + correction) & 0xff;
+						unsigned expected = result << 8 | (result == 0 ? FLAG_Z : 0) |
+							(negative ? FLAG_N : 0) | (correction >= 0x60 ? FLAG_C : 0);
+
+						INFO("A 0x" << std::hex << a << ", F 0x" << flags);
+						REQUIRE(TestCPU::daaTable(static_cast<BYTE>(a), static_cast<BYTE>(flags)) == expected);
+					}
+				}
+			}
+		}
+	}
+}
+#endif
+
 SCENARIO("Testing extended instructions", "[cpu]") {
 	GIVEN("CPU-derivative") {
 		std::array<BYTE, 0x10000> data = {{ 0 }};
@@ -1290,3 +1374,567 @@ SCENARIO("Testing control-flow instructions", "[cpu]") {
 		}
 	}
 }
+
+// Runs every implemented opcode (and every extended opcode) at the PC, eight times each on random
+// memory and registers: the reference engine steps it, the tested one runs it for one instruction
+// (every instruction takes at least one cycle). Registers, cycles and memory must be identical.
+static void compareEngines(CPU::Engine reference, CPU::Engine tested, WORD pc, unsigned seed) {
+	auto memReference = std::make_unique<std::array<BYTE, 0x10000>>();
+	auto memTested = std::make_unique<std::array<BYTE, 0x10000>>();
+	TestMMU mmuReference{*memReference};
+	TestMMU mmuTested{*memTested};
+	std::mt19937 rng{seed};
+
+	for (int op = 0; op < 0x100 + 0x100; op++) {
+		for (int i = 0; i < 8; i++) {
+			TestCPU expected{mmuReference, reference};
+			TestCPU actual{mmuTested, tested};
+			if (op < 0x100 && !expected.hasInstruction(static_cast<BYTE>(op))) {
+				break;
+			}
+
+			for (auto& v : *memReference) {
+				v = static_cast<BYTE>(rng());
+			}
+			std::array<WORD, 6> regs{};
+			for (auto& r : regs) {
+				r = static_cast<WORD>(rng());
+			}
+			regs[5] = pc;
+			if (op < 0x100) {
+				(*memReference)[pc] = static_cast<BYTE>(op);
+			} else {
+				(*memReference)[pc] = 0xcb;
+				(*memReference)[static_cast<WORD>(pc + 1)] = static_cast<BYTE>(op);
+			}
+			*memTested = *memReference;
+
+			expected.setRegisters(regs);
+			actual.setRegisters(regs);
+			DWORD cyclesExpected = expected.step();
+			DWORD cyclesActual = actual.run(1);
+
+			INFO("opcode 0x" << std::hex << op);
+			REQUIRE(expected.getRegisters() == actual.getRegisters());
+			REQUIRE(cyclesExpected == cyclesActual);
+			REQUIRE(*memReference == *memTested);
+		}
+	}
+}
+
+SCENARIO("Switch engine should match the table engine", "[cpu]") {
+	GIVEN("two CPU-derivatives running on identical random memory") {
+		WHEN("stepping every implemented opcode (and every extended opcode) once") {
+			THEN("registers, cycles and memory are identical") {
+				compareEngines(CPU::Engine::Table, CPU::Engine::Switch, 0x0100, 1234);
+			}
+		}
+	}
+}
+
+SCENARIO("Threaded engine should match the switch engine", "[cpu]") {
+	GIVEN("two CPU-derivatives running on identical random memory") {
+		WHEN("running every implemented opcode (and every extended opcode) for one instruction") {
+			THEN("registers, cycles and memory are identical") {
+				compareEngines(CPU::Engine::Switch, CPU::Engine::Threaded, 0x0100, 4321);
+			}
+		}
+	}
+}
+
+SCENARIO("Cached engine should match the switch engine", "[cpu]") {
+	GIVEN("two CPU-derivatives running on identical random memory") {
+		WHEN("running every implemented opcode (and every extended opcode) for one instruction") {
+			THEN("registers, cycles and memory are identical") {
+				compareEngines(CPU::Engine::Switch, CPU::Engine::Cached, 0xc100, 5678);
+			}
+		}
+	}
+
+	GIVEN("a loop in WRAM that patches its own first instruction") {
+		std::array<BYTE, 0x10000> dataSwitch = {{ 0 }};
+		std::array<BYTE, 0x10000> dataCached = {{ 0 }};
+		const std::array<BYTE, 10> program{{
+			0x0e, 0x00,		// 0xc000: LD C, 0
+			0x3e, 0x0c,		// 0xc002: LD A, 0x0c (INC C)
+			0x00,			// 0xc004: NOP, becomes INC C
+			0xea, 0x04, 0xc0,	// 0xc005: LD (0xc004), A
+			0x18, 0xfa,		// 0xc008: JR 0xc004
+		}};
+		std::copy(program.begin(), program.end(), dataSwitch.begin() + 0xc000);
+		std::copy(program.begin(), program.end(), dataCached.begin() + 0xc000);
+		TestMMU mmuSwitch{dataSwitch};
+		TestMMU mmuCached{dataCached};
+		TestCPU sw{mmuSwitch, CPU::Engine::Switch};
+		TestCPU cached{mmuCached, CPU::Engine::Cached};
+		sw.setPC(0xc000);
+		cached.setPC(0xc000);
+
+		WHEN("running both for a while") {
+			sw.run(1000);
+			cached.run(1000);
+
+			THEN("the cached engine executes the patched instruction") {
+				REQUIRE(cached.getC() > 0);
+				REQUIRE(sw.getRegisters() == cached.getRegisters());
+			}
+		}
+	}
+}
+
+SCENARIO("JIT engine should match the switch engine in lock-step", "[cpu]") {
+	GIVEN("random loops of instructions that don't write memory") {
+		auto memSwitch = std::make_unique<std::array<BYTE, 0x10000>>();
+		auto memJit = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmuSwitch{*memSwitch};
+		TestMMU mmuJit{*memJit};
+		std::mt19937 rng{9012};
+
+		// everything up to 0xbf and ALU A, n, without jumps, HALT, STOP and memory writes
+		std::vector<BYTE> pool;
+		{
+			TestCPU probe{mmuSwitch};
+			for (int op = 0; op < 0x100; op++) {
+				BYTE opcode = static_cast<BYTE>(op);
+				bool write = opcode == 0x02 || opcode == 0x08 || opcode == 0x12 || opcode == 0x22 || opcode == 0x32 ||
+					opcode == 0x34 || opcode == 0x35 || opcode == 0x36 || (0x70 <= opcode && opcode <= 0x77);
+				bool jump = (opcode & 0xe7) == 0x20 || opcode == 0x18;
+				bool alu = opcode < 0xc0 || (opcode & 0xc7) == 0xc6;
+				if (probe.hasInstruction(opcode) && alu && !write && !jump && opcode != 0x10) {
+					pool.push_back(opcode);
+				}
+			}
+		}
+
+		WHEN("running both with random cycle budgets") {
+			THEN("registers and cycles are identical after every batch") {
+				for (int program = 0; program < 64; program++) {
+					for (auto& v : *memSwitch) {
+						v = static_cast<BYTE>(rng());
+					}
+					// 0x0200: body, JR NZ 0x0200, body, JR 0x0200
+					WORD addr = 0x0200;
+					for (int part = 0; part < 2; part++) {
+						for (int i = 0; i < 12; i++) {
+							BYTE opcode = pool[rng() % pool.size()];
+							(*memSwitch)[addr] = opcode;
+							addr = static_cast<WORD>(addr + OPCODES[opcode].length);
+						}
+						(*memSwitch)[addr++] = part == 0 ? 0x20 : 0x18;
+						(*memSwitch)[addr] = static_cast<BYTE>(0x0200 - (addr + 1));
+						addr++;
+					}
+					*memJit = *memSwitch;
+
+					TestCPU sw{mmuSwitch, CPU::Engine::Switch};
+					TestCPU jit{mmuJit, CPU::Engine::Jit};
+					std::array<WORD, 6> regs{};
+					for (auto& r : regs) {
+						r = static_cast<WORD>(rng());
+					}
+					regs[5] = 0x0200;
+					sw.setRegisters(regs);
+					jit.setRegisters(regs);
+
+					for (int batch = 0; batch < 200; batch++) {
+						DWORD budget = 1 + static_cast<DWORD>(rng() % 40);
+						DWORD cyclesSwitch = sw.run(budget);
+						DWORD cyclesJit = jit.run(budget);
+
+						INFO("program " << program << ", batch " << batch);
+						REQUIRE(sw.getRegisters() == jit.getRegisters());
+						REQUIRE(cyclesSwitch == cyclesJit);
+					}
+					if (Jit::available()) {
+						REQUIRE(jit.translated(0x0200));
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Lazy flags should match eagerly computed flags", "[cpu]") {
+	GIVEN("two CPU-derivatives running on identical random memory, one with lazy flags") {
+		auto memEager = std::make_unique<std::array<BYTE, 0x10000>>();
+		auto memLazy = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmuEager{*memEager};
+		TestMMU mmuLazy{*memLazy};
+		std::mt19937 rng{3456};
+
+		// instructions leaving lazy flags behind
+		const std::array<BYTE, 16> producers{{
+			0x80, 0x89, 0x92, 0x9b, 0xa4, 0xad, 0xb6, 0xbf, 0xc6, 0xce, 0xd6, 0xde, 0x04, 0x0d, 0x34, 0x3d,
+		}};
+
+		WHEN("running a lazy ALU instruction followed by every implemented opcode (and every extended opcode)") {
+			THEN("registers, cycles and memory are identical") {
+				for (int op = 0; op < 0x100 + 0x100; op++) {
+					for (int i = 0; i < 8; i++) {
+						TestCPU eager{mmuEager, CPU::Engine::Switch};
+						TestCPU lazy{mmuLazy, CPU::Engine::Switch};
+						lazy.setLazyFlags(true);
+						if (op < 0x100 && !eager.hasInstruction(static_cast<BYTE>(op))) {
+							break;
+						}
+
+						for (auto& v : *memEager) {
+							v = static_cast<BYTE>(rng());
+						}
+						std::array<WORD, 6> regs{};
+						for (auto& r : regs) {
+							r = static_cast<WORD>(rng());
+						}
+						regs[5] = 0xc100;
+						(*memEager)[0xc100] = producers[rng() % producers.size()];
+						(*memEager)[0xc101] = 0x00;
+						(*memEager)[0xc102] = 0x00;
+						if (op < 0x100) {
+							(*memEager)[0xc102] = static_cast<BYTE>(op);
+						} else {
+							(*memEager)[0xc102] = 0xcb;
+							(*memEager)[0xc103] = static_cast<BYTE>(op);
+						}
+						*memLazy = *memEager;
+
+						eager.setRegisters(regs);
+						lazy.setRegisters(regs);
+						// ALU A, n consume the byte after them, the others run a NOP in between
+						DWORD cyclesEager = eager.step();
+						DWORD cyclesLazy = lazy.step();
+						if (eager.getRegisters()[5] == 0xc101) {
+							cyclesEager += eager.step();
+							cyclesLazy += lazy.step();
+						}
+						cyclesEager += eager.step();
+						cyclesLazy += lazy.step();
+
+						INFO("opcode 0x" << std::hex << op);
+						REQUIRE(eager.getRegisters() == lazy.getRegisters());
+						REQUIRE(cyclesEager == cyclesLazy);
+						REQUIRE(*memEager == *memLazy);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Opcode metadata should match the implemented instructions", "[cpu]") {
+	GIVEN("a CPU-derivative on random memory") {
+		auto mem = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmu{*mem};
+		std::mt19937 rng{7890};
+
+		WHEN("stepping every implemented opcode (and every extended opcode)") {
+			THEN("length, cycles and untouched flags are as described") {
+				for (int op = 0; op < 0x100 + 0x100; op++) {
+					for (int i = 0; i < 8; i++) {
+						TestCPU cpu{mmu};
+						// 0xcb is covered by the extended opcodes
+						if (op == 0xcb || (op < 0x100 && !cpu.hasInstruction(static_cast<BYTE>(op)))) {
+							break;
+						}
+
+						for (auto& v : *mem) {
+							v = static_cast<BYTE>(rng());
+						}
+						std::array<WORD, 6> regs{};
+						for (auto& r : regs) {
+							r = static_cast<WORD>(rng());
+						}
+						regs[5] = 0xc100;
+						(*mem)[0xc100] = static_cast<BYTE>(op < 0x100 ? op : 0xcb);
+						(*mem)[0xc101] = static_cast<BYTE>(op);
+						cpu.setRegisters(regs);
+
+						const auto& info = (op < 0x100) ? OPCODES[static_cast<BYTE>(op)] : CB_OPCODES[static_cast<BYTE>(op)];
+						DWORD cycles = cpu.step();
+						auto after = cpu.getRegisters();
+
+						INFO("opcode 0x" << std::hex << op << " " << info.mnemonic);
+						REQUIRE(info.mnemonic != nullptr);
+						if (info.flow == Flow::NONE) {
+							REQUIRE(after[5] == 0xc100 + (op < 0x100 ? info.length : 2));
+						}
+						if (info.takenCycles == 0) {
+							REQUIRE(cycles == info.cycles);
+						} else {
+							REQUIRE((cycles == info.cycles || cycles == info.takenCycles));
+						}
+						REQUIRE(((after[0] ^ regs[0]) & FLAGS_ALL & ~info.flagsWritten) == 0);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("HALT should skip to the end of the budget until an enabled interrupt is requested", "[cpu]") {
+	GIVEN("HALT followed by INC B") {
+		auto mem = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmu{*mem};
+		(*mem)[0xc000] = 0x76;
+		(*mem)[0xc001] = 0x04;
+		(*mem)[0xc002] = 0x18;
+		(*mem)[0xc003] = 0xfe;
+
+		WHEN("running on every engine, then requesting an enabled interrupt while interrupts are disabled") {
+			THEN("the budget passes without executing anything, then the CPU continues after HALT") {
+				for (auto engine : { CPU::Engine::Table, CPU::Engine::Switch, CPU::Engine::Threaded, CPU::Engine::Cached, CPU::Engine::Jit }) {
+					TestCPU cpu{mmu, engine};
+					cpu.setPC(0xc000);
+					cpu.setB(0);
+
+					INFO("engine " << static_cast<int>(engine));
+					REQUIRE(cpu.run(1000) == 1000);
+					REQUIRE(cpu.getPC() == 0xc001);
+					REQUIRE(cpu.run(1000) == 1000);
+					REQUIRE(cpu.getB() == 0);
+
+					cpu.setIME(false);
+					intState_.setIntEnable(0x01);
+					intState_.setIntFlag(0x01);
+					cpu.run(1);
+					intState_.setIntEnable(0);
+					intState_.setIntFlag(0);
+					REQUIRE(cpu.getB() == 1);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Interrupts should be dispatched in order of priority", "[cpu]") {
+	GIVEN("a RETI at every interrupt vector and all five interrupts requested") {
+		auto mem = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmu{*mem};
+		for (WORD vector = 0x40; vector <= 0x60; vector = static_cast<WORD>(vector + 8)) {
+			(*mem)[vector] = 0xd9;
+		}
+
+		TestCPU cpu{mmu, CPU::Engine::Switch};
+		cpu.setPC(0xc000);
+		cpu.setSP(0xfffe);
+		cpu.setIME(true);
+		intState_.setIntFlag(0x1f);
+		intState_.setIntEnable(0x1d);
+
+		WHEN("stepping through the handlers") {
+			std::vector<WORD> vectors;
+			while (intState_.pending() != 0) {
+				cpu.handleInterrupts();
+				vectors.push_back(cpu.getPC());
+				cpu.step();
+			}
+			BYTE flags = intState_.intFlag();
+			intState_.setIntFlag(0);
+			intState_.setIntEnable(0);
+
+			THEN("the enabled ones are taken from VBlank to joypad and acknowledged") {
+				REQUIRE(vectors == (std::vector<WORD>{ 0x40, 0x50, 0x58, 0x60 }));
+				REQUIRE(cpu.getPC() == 0xc000);
+				REQUIRE(flags == 0x02);
+			}
+		}
+	}
+}
+
+SCENARIO("The profiler should attribute cycles to the shadow call stack", "[cpu]") {
+	GIVEN("a CALL to a function that calls another one, an RST and an interrupt") {
+		auto mem = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmu{*mem};
+		std::vector<BYTE> program{
+			0xcd, 0x10, 0xc0,	// 0xc000: CALL 0xc010
+			0xcf,			// RST 0x08
+			0x18, 0xfe,		// 0xc004: JR -2
+		};
+		std::copy(program.begin(), program.end(), mem->begin() + 0xc000);
+		(*mem)[0xc010] = 0x04;	// INC B
+		(*mem)[0xc011] = 0xcd;	// CALL 0xc020
+		(*mem)[0xc012] = 0x20;
+		(*mem)[0xc013] = 0xc0;
+		(*mem)[0xc014] = 0xc9;	// RET
+		(*mem)[0xc020] = 0xc9;	// RET
+		(*mem)[0x0008] = 0xc9;	// RET
+		(*mem)[0x0040] = 0xd9;	// RETI
+
+		TestCPU cpu{mmu, CPU::Engine::Switch};
+		cpu.setPC(0xc000);
+		cpu.setSP(0xfffe);
+		cpu.setIME(false);
+		cpu.setProfiling(true);
+
+		WHEN("running up to the loop one instruction at a time, then taking a VBlank interrupt") {
+			std::vector<std::size_t> depths;
+			while (cpu.getPC() != 0xc004) {
+				cpu.run(1);
+				depths.push_back(cpu.profiler()->depth());
+			}
+			cpu.setIME(true);
+			intState_.setIntEnable(0x01);
+			intState_.setIntFlag(0x01);
+			cpu.run(1);
+			intState_.setIntEnable(0);
+			depths.push_back(cpu.profiler()->depth());
+			cpu.run(1);
+			depths.push_back(cpu.profiler()->depth());
+
+			THEN("the stack follows the calls and returns, the interrupt handler returns within the same run()") {
+				REQUIRE(depths == (std::vector<std::size_t>{ 2, 2, 3, 2, 1, 2, 1, 1, 1 }));
+			}
+			THEN("every location and call path has its own cost") {
+				auto ret = cpu.profiler()->at(Profiler::location(0, 0xc014));
+				REQUIRE(ret.instructions == 1);
+				REQUIRE(ret.cycles == 16);
+
+				std::ostringstream folded;
+				cpu.profiler()->writeFolded(folded);
+				REQUIRE(folded.str() ==
+					"00:c000 52\n"
+					"00:c000;00:c010 44\n"
+					"00:c000;00:c010;00:c020 16\n"
+					"00:c000;00:0008 16\n"
+					"00:c000;00:0040 16\n");
+
+				std::ostringstream callgrind;
+				cpu.profiler()->writeCallgrind(callgrind);
+				REQUIRE(callgrind.str().find("fn=00:c010\n0xc010 1 4\n0xc011 1 24\n0xc014 1 16\ncfn=00:c020\ncalls=1 0xc020\n0xc011 1 16\n") != std::string::npos);
+			}
+		}
+	}
+}
+
+SCENARIO("Restoring a snapshot should replay the same instructions", "[cpu]") {
+	GIVEN("a loop of 8-bit ALU instructions on the cached engine with lazy flags") {
+		auto mem = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmu{*mem};
+		std::vector<BYTE> program{
+			0x06, 0x00,	// 0xc000: LD B, 0
+			0x81,		// 0xc002: ADD A, C
+			0xaa,		// XOR D
+			0x93,		// SUB E
+			0x0c,		// INC C
+			0x88,		// ADC A, B
+			0x14,		// INC D
+			0x9b,		// SBC A, E
+			0x1d,		// DEC E
+			0x05,		// DEC B
+			0x20, 0xf5,	// JR NZ, 0xc002
+			0x18, 0xf1,	// JR 0xc000
+		};
+		std::copy(program.begin(), program.end(), mem->begin() + 0xc000);
+
+		TestCPU cpu{mmu, CPU::Engine::Cached};
+		cpu.setLazyFlags(true);
+		cpu.setPC(0xc000);
+		cpu.setIME(true);
+		cpu.run(1000);
+
+		WHEN("taking a snapshot, running on, restoring it and running the same number of cycles again") {
+			CPUState snapshot = cpu.snapshot();
+			cpu.run(5000);
+			auto registers = cpu.getRegisters();
+			cpu.restore(snapshot);
+			auto restored = cpu.getRegisters();
+			cpu.run(5000);
+
+			THEN("the registers after restoring are the snapshot's, and the registers after running are the same") {
+				REQUIRE(restored == (std::array<WORD, 6>{{ snapshot.af, snapshot.bc, snapshot.de, snapshot.hl, snapshot.sp, snapshot.pc }}));
+				REQUIRE(snapshot.ime);
+				REQUIRE(cpu.getRegisters() == registers);
+			}
+		}
+	}
+}
+
+SCENARIO("The trace should keep the last instructions up to a missing one", "[cpu]") {
+	GIVEN("a program ending in a missing opcode, traced into 4 entries") {
+		auto mem = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmu{*mem};
+		std::vector<BYTE> program{
+			0x3e, 0x12,		// 0xc000: LD A, 0x12
+			0x21, 0x34, 0x12,	// 0xc002: LD HL, 0x1234
+			0x04,			// 0xc005: INC B
+			0x00,			// 0xc006: NOP
+			0x3c,			// 0xc007: INC A
+			0xd3,			// 0xc008: missing
+		};
+		std::copy(program.begin(), program.end(), mem->begin() + 0xc000);
+
+		TestCPU cpu{mmu, CPU::Engine::Switch};
+		cpu.setPC(0xc000);
+		cpu.setTracing(4);
+
+		WHEN("running into the missing opcode") {
+			REQUIRE_THROWS(cpu.run(1000));
+
+			THEN("the trace holds the last 4 instructions, the missing one last, and survives writing and reading") {
+				auto entries = cpu.trace()->entries();
+				REQUIRE(entries.size() == 4);
+				std::vector<WORD> pcs;
+				for (const auto& entry : entries) {
+					pcs.push_back(entry.pc);
+				}
+				REQUIRE(pcs == (std::vector<WORD>{ 0xc005, 0xc006, 0xc007, 0xc008 }));
+				REQUIRE(entries[3].opcode == 0xd3);
+				REQUIRE(entries[1].af >> 8 == 0x12);
+				REQUIRE(entries[1].bc == 0x0100);
+				REQUIRE(entries[1].hl == 0x1234);
+				// LD A, n and LD HL, nn take 8 and 12 cycles, INC B, NOP and INC A 4 each
+				REQUIRE(entries[0].stamp == 20);
+				REQUIRE(entries[3].stamp == 32);
+
+				std::stringstream file;
+				cpu.trace()->write(file);
+				auto read = Trace::read(file);
+				REQUIRE(read.size() == 4);
+				REQUIRE(Trace::format(read[3]) == Trace::format(entries[3]));
+				REQUIRE(Trace::format(read[0]).find("INC B") != std::string::npos);
+			}
+		}
+	}
+}
+
+SCENARIO("A debugger should be called at breakpoints and after single steps", "[cpu]") {
+	class TestDebugger : public Debugger {
+		public:
+			bool stopped(CPUState& state, Breakpoints& breakpoints) override {
+				stops.push_back(state.pc);
+				if (stops.size() == 1) {
+					breakpoints.set(0xc005);
+					return false;
+				}
+				// step over the breakpoint and one more instruction, then remove it
+				breakpoints.set(0xc005, false);
+				return stops.size() < 3;
+			}
+			std::vector<WORD> stops;
+	};
+
+	GIVEN("a loop on the threaded engine with a debugger attached") {
+		auto mem = std::make_unique<std::array<BYTE, 0x10000>>();
+		TestMMU mmu{*mem};
+		std::vector<BYTE> program{
+			0x3e, 0x12,		// 0xc000: LD A, 0x12
+			0x21, 0x34, 0x12,	// 0xc002: LD HL, 0x1234
+			0x04,			// 0xc005: INC B
+			0x00,			// 0xc006: NOP
+			0x18, 0xfc,		// 0xc007: JR 0xc005
+		};
+		std::copy(program.begin(), program.end(), mem->begin() + 0xc000);
+
+		TestCPU cpu{mmu, CPU::Engine::Threaded};
+		cpu.setPC(0xc000);
+		TestDebugger debugger;
+		cpu.setDebugger(&debugger);
+
+		WHEN("running") {
+			cpu.run(1000);
+
+			THEN("it stops before the first instruction, at the breakpoint and after stepping once") {
+				REQUIRE(debugger.stops == (std::vector<WORD>{ 0xc000, 0xc005, 0xc006 }));
+			}
+		}
+	}
+}
@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "catch.hpp"
+#include "codemap.h"
+#include "emulator.h"
+#include "romonly.h"
+
+namespace {
+class FrameDisplay : public IDisplay {
+	public:
+		void render(PixelArray& pixels) override {
+			last = pixels;
+			frames++;
+		}
+		PixelArray last{{0}};
+		int frames = 0;
+};
+
+// passes the boot ROM's checks, so it scrolls the logo and then loops at 0x0100
+void makeBootable(std::vector<BYTE>& rom) {
+	static const std::array<BYTE, 48> logo{{
+		0xce, 0xed, 0x66, 0x66, 0xcc, 0x0d, 0x00, 0x0b, 0x03, 0x73, 0x00, 0x83,
+		0x00, 0x0c, 0x00, 0x0d, 0x00, 0x08, 0x11, 0x1f, 0x88, 0x89, 0x00, 0x0e,
+		0xdc, 0xcc, 0x6e, 0xe6, 0xdd, 0xdd, 0xd9, 0x99, 0xbb, 0xbb, 0x67, 0x63,
+		0x6e, 0x0e, 0xec, 0xcc, 0xdd, 0xdc, 0x99, 0x9f, 0xbb, 0xb9, 0x33, 0x3e,
+	}};
+	if (rom[0x100] == 0) {
+		rom[0x100] = 0x18;
+		rom[0x101] = 0xfe;
+	}
+	std::copy(logo.begin(), logo.end(), rom.begin() + 0x104);
+	rom[0x14d] = 0xe7;
+}
+
+std::unique_ptr<Mapper> bootableRom(std::vector<BYTE> rom = std::vector<BYTE>(0x8000, 0)) {
+	makeBootable(rom);
+	return std::unique_ptr<Mapper>{new RomOnly{std::move(rom)}};
+}
+
+// counts VBlank interrupts in 0xc000 and halts in between, after one OAM DMA from 0xc000
+std::vector<BYTE> vblankCountingRom() {
+	std::vector<BYTE> rom(0x8000, 0);
+	const std::array<BYTE, 5> handler{{
+		0x21, 0x00, 0xc0,	// 0x0040: LD HL, 0xc000
+		0x34,			// INC (HL)
+		0xd9,			// RETI
+	}};
+	const std::array<BYTE, 12> main{{
+		0x3e, 0xc0,		// 0x0150: LD A, 0xc0
+		0xe0, 0x46,		// LDH (0x46), A
+		0x3e, 0x01,		// LD A, 1
+		0xe0, 0xff,		// LDH (0xff), A
+		0xfb,			// EI
+		0x76,			// 0x0159: HALT
+		0x18, 0xfd,		// JR 0x0159
+	}};
+	std::copy(handler.begin(), handler.end(), rom.begin() + 0x40);
+	std::copy(main.begin(), main.end(), rom.begin() + 0x150);
+	// 0x0100: JP 0x0150
+	rom[0x100] = 0xc3;
+	rom[0x101] = 0x50;
+	rom[0x102] = 0x01;
+	return rom;
+}
+
+// 16 KiB banks, a write to 0x2000-0x3fff selects the one at 0x4000-0x7fff (bank 0 selects 1)
+class BankedRom : public Mapper {
+	public:
+		explicit BankedRom(std::vector<BYTE>&& rom) : Mapper{std::move(rom)} {}
+
+		BYTE readByte(WORD addr) override {
+			return addr < 0x4000 ? m_rom[addr] : m_rom[romBank() * 0x4000u + (addr - 0x4000u)];
+		}
+		void writeByte(WORD addr, BYTE v) override {
+			if (addr >= 0x2000 && addr <= 0x3fff) {
+				switchBank(std::max<BYTE>(static_cast<BYTE>(v & 0x03), 1));
+			}
+		}
+};
+
+class BankDebugger : public Debugger {
+	public:
+		bool stopped(CPUState& state, Breakpoints&) override {
+			if (state.pc == 0x4000) {
+				stops++;
+			}
+			return false;
+		}
+		int stops = 0;
+};
+}
+
+SCENARIO("Running in batches should render the same frames as stepping every instruction", "[emulator]") {
+	GIVEN("the boot ROM run one instruction per GPU update and in batches up to the next GPU event") {
+		FrameDisplay stepDisplay;
+		FrameDisplay batchDisplay;
+		InterruptState intState{};
+		GPU gpu{stepDisplay, intState};
+		MMU mmu{bootableRom(), gpu, intState};
+		CPU cpu{mmu, intState, CPU::Engine::Switch};
+		Emulator emulator{bootableRom(), batchDisplay, CPU::Engine::Threaded};
+
+		WHEN("running for 120 frames") {
+			THEN("every frame is identical") {
+				for (int frame = 0; frame < 120; frame++) {
+					while (stepDisplay.frames == frame) {
+						cpu.handleInterrupts();
+						gpu.step(cpu.step());
+					}
+					auto summary = emulator.runFrame();
+
+					INFO("frame " << frame);
+					REQUIRE(summary.frames == 1);
+					REQUIRE(batchDisplay.frames == stepDisplay.frames);
+					REQUIRE(batchDisplay.last == stepDisplay.last);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("runFor should stop right after the requested number of cycles", "[emulator]") {
+	GIVEN("an emulator running the boot ROM") {
+		FrameDisplay display;
+		Emulator emulator{bootableRom(), display};
+
+		WHEN("running for one frame's worth of cycles") {
+			auto summary = emulator.runFor(70224);
+
+			THEN("it overshoots by less than one instruction and syncs once per GPU event") {
+				REQUIRE(summary.cycles >= 70224);
+				REQUIRE(summary.cycles < 70224 + 24);
+				REQUIRE(summary.frames == 1);
+				// 144 lines of three modes plus 10 VBlank lines
+				REQUIRE(summary.syncs >= 144 * 3 + 10);
+				REQUIRE(summary.syncs <= 144 * 3 + 10 + 2);
+			}
+		}
+	}
+}
+
+SCENARIO("A halted CPU should wake up for every VBlank interrupt", "[emulator]") {
+	GIVEN("a cartridge that counts VBlank interrupts in 0xc000 and halts in between") {
+		FrameDisplay display;
+		Emulator emulator{bootableRom(vblankCountingRom()), display, CPU::Engine::Threaded};
+
+		WHEN("running past the boot ROM and then for 60 more frames") {
+			for (int frame = 0; frame < 400; frame++) {
+				emulator.runFrame();
+			}
+			BYTE before = emulator.mmu().readByte(0xc000);
+			for (int frame = 0; frame < 60; frame++) {
+				emulator.runFrame();
+			}
+
+			THEN("every one of them was counted") {
+				REQUIRE(static_cast<BYTE>(emulator.mmu().readByte(0xc000) - before) == 60);
+			}
+		}
+	}
+}
+
+SCENARIO("Skipping idle loops should render the same frames", "[emulator]") {
+	GIVEN("the boot ROM, which polls LY while scrolling the logo") {
+		WHEN("running 120 frames with and without idle-loop skipping on every engine") {
+			THEN("every frame and the cycle count are identical, and cycles were skipped") {
+				for (auto engine : { CPU::Engine::Switch, CPU::Engine::Threaded, CPU::Engine::Cached, CPU::Engine::Jit }) {
+					FrameDisplay plainDisplay;
+					FrameDisplay skipDisplay;
+					Emulator plain{bootableRom(), plainDisplay, engine};
+					Emulator skip{bootableRom(), skipDisplay, engine};
+					skip.cpu().setIdleSkipping(true);
+
+					DWORD skipped = 0;
+					for (int frame = 0; frame < 120; frame++) {
+						auto plainSummary = plain.runFrame();
+						auto skipSummary = skip.runFrame();
+						skipped += skipSummary.skipped;
+
+						INFO("engine " << static_cast<int>(engine) << ", frame " << frame);
+						REQUIRE(plainSummary.skipped == 0);
+						REQUIRE(plainSummary.cycles == skipSummary.cycles);
+						REQUIRE(plainDisplay.last == skipDisplay.last);
+					}
+					REQUIRE(skipped > 0);
+					REQUIRE(skip.cpu().skippedCycles() == skipped);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Superinstructions should render the same frames", "[emulator]") {
+	GIVEN("the boot ROM, whose LY polling loop is the most frequent pair of opcodes") {
+		WHEN("running 120 frames on the cached engine with and without superinstructions") {
+			THEN("every frame and the cycle count are identical, with and without idle-loop skipping") {
+				for (bool skipIdle : { false, true }) {
+					FrameDisplay plainDisplay;
+					FrameDisplay fusedDisplay;
+					Emulator plain{bootableRom(), plainDisplay, CPU::Engine::Cached};
+					Emulator fused{bootableRom(), fusedDisplay, CPU::Engine::Cached};
+					plain.cpu().setSuperinstructions(false);
+					plain.cpu().setIdleSkipping(skipIdle);
+					fused.cpu().setIdleSkipping(skipIdle);
+
+					for (int frame = 0; frame < 120; frame++) {
+						auto plainSummary = plain.runFrame();
+						auto fusedSummary = fused.runFrame();
+
+						INFO("idle skipping " << skipIdle << ", frame " << frame);
+						REQUIRE(plainSummary.cycles == fusedSummary.cycles);
+						REQUIRE(plainSummary.skipped == fusedSummary.skipped);
+						REQUIRE(plainDisplay.last == fusedDisplay.last);
+					}
+				}
+			}
+		}
+		WHEN("profiling the pairs of opcodes for 120 frames") {
+			FrameDisplay display;
+			Emulator emulator{bootableRom(), display, CPU::Engine::Cached};
+			emulator.cpu().setPairProfiling(true);
+			for (int frame = 0; frame < 120; frame++) {
+				emulator.runFrame();
+			}
+			std::ostringstream out;
+			emulator.cpu().writeSuperinstructions(out, 2);
+			std::string header = out.str();
+
+			THEN("the two most frequent pairs are the loop's LDH A, (0x44); CP 0x90 and CP 0x90; JR NZ") {
+				REQUIRE(header.find("X(0xfe, 0x20)") != std::string::npos);
+				REQUIRE(header.find("X(0xf0, 0xfe)") != std::string::npos);
+				// SUPERINSTRUCTIONS(X) and the two pairs
+				REQUIRE(std::count(header.begin(), header.end(), 'X') == 3);
+			}
+		}
+	}
+}
+
+SCENARIO("LY reaching LYC should request an LCD STAT interrupt", "[emulator]") {
+	GIVEN("a cartridge that enables the LYC interrupt for line 10 and counts it in 0xc000") {
+		std::vector<BYTE> rom(0x8000, 0);
+		const std::array<BYTE, 10> handler{{
+			0x21, 0x00, 0xc0,	// 0x0048: LD HL, 0xc000
+			0x34,			// INC (HL)
+			0xf0, 0x44,		// LDH A, (0x44)
+			0xea, 0x01, 0xc0,	// LD (0xc001), A
+			0xd9,			// RETI
+		}};
+		const std::array<BYTE, 16> main{{
+			0x3e, 0x0a,		// 0x0150: LD A, 10
+			0xe0, 0x45,		// LDH (0x45), A
+			0x3e, 0x40,		// LD A, 0x40
+			0xe0, 0x41,		// LDH (0x41), A
+			0x3e, 0x02,		// LD A, 2
+			0xe0, 0xff,		// LDH (0xff), A
+			0xfb,			// EI
+			0x76,			// 0x015d: HALT
+			0x18, 0xfd,		// JR 0x015d
+		}};
+		std::copy(handler.begin(), handler.end(), rom.begin() + 0x48);
+		std::copy(main.begin(), main.end(), rom.begin() + 0x150);
+		// 0x0100: JP 0x0150
+		rom[0x100] = 0xc3;
+		rom[0x101] = 0x50;
+		rom[0x102] = 0x01;
+
+		FrameDisplay display;
+		Emulator emulator{bootableRom(rom), display};
+
+		WHEN("running past the boot ROM and then for 60 more frames") {
+			for (int frame = 0; frame < 400; frame++) {
+				emulator.runFrame();
+			}
+			BYTE before = emulator.mmu().readByte(0xc000);
+			for (int frame = 0; frame < 60; frame++) {
+				emulator.runFrame();
+			}
+
+			THEN("the handler ran once per frame, on line 10") {
+				REQUIRE(static_cast<BYTE>(emulator.mmu().readByte(0xc000) - before) == 60);
+				REQUIRE(emulator.mmu().readByte(0xc001) == 10);
+			}
+		}
+	}
+}
+
+SCENARIO("A code map should render the same frames", "[emulator]") {
+	GIVEN("a ROM whose code map is loaded before booting") {
+		WHEN("running 120 frames on the cached engine with and without the map") {
+			THEN("every frame and the cycle count are identical") {
+				FrameDisplay plainDisplay;
+				FrameDisplay mappedDisplay;
+				Emulator plain{bootableRom(), plainDisplay, CPU::Engine::Cached};
+				Emulator mapped{bootableRom(), mappedDisplay, CPU::Engine::Cached};
+				auto rom = bootableRom();
+				mapped.cpu().setCodeMap(CodeMap::discover(*rom));
+
+				for (int frame = 0; frame < 120; frame++) {
+					auto plainSummary = plain.runFrame();
+					auto mappedSummary = mapped.runFrame();
+
+					INFO("frame " << frame);
+					REQUIRE(plainSummary.cycles == mappedSummary.cycles);
+					REQUIRE(plainDisplay.last == mappedDisplay.last);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("The M-cycle accurate mode should tick the GPU before every memory access", "[emulator]") {
+	GIVEN("LDH A, (0x44) in WRAM, 8 cycles before LY changes") {
+		for (bool accurate : { false, true }) {
+			FrameDisplay display;
+			Emulator emulator{bootableRom(), display};
+			emulator.setCycleAccurate(accurate);
+			emulator.mmu().writeByte(0xc000, 0xf0);
+			emulator.mmu().writeByte(0xc001, 0x44);
+			CPUState state = emulator.snapshot();
+			state.pc = 0xc000;
+			emulator.restore(state);
+			// the first HBlank is 204 cycles
+			emulator.gpu().step(196);
+
+			auto summary = emulator.runFor(12);
+			BYTE ly = static_cast<BYTE>(emulator.snapshot().af >> 8);
+
+			INFO("accurate " << accurate);
+			REQUIRE(summary.cycles == 12);
+			// the read is the third M-cycle, after LY has changed
+			REQUIRE(ly == (accurate ? 1 : 0));
+		}
+	}
+	GIVEN("the boot ROM") {
+		WHEN("running it to its end in both modes") {
+			THEN("the frames take as long and the last one is identical") {
+				FrameDisplay fastDisplay;
+				FrameDisplay accurateDisplay;
+				Emulator fast{bootableRom(), fastDisplay};
+				Emulator accurate{bootableRom(), accurateDisplay};
+				accurate.setCycleAccurate(true);
+
+				// LY is seen a few cycles earlier, which may move the scrolling logo by a frame
+				for (int frame = 0; frame < 400; frame++) {
+					auto fastSummary = fast.runFrame();
+					auto accurateSummary = accurate.runFrame();
+
+					INFO("frame " << frame);
+					// frames end after the instruction that crosses them, which may be a different one
+					REQUIRE(std::abs(static_cast<long>(fastSummary.cycles) - static_cast<long>(accurateSummary.cycles)) <= 24);
+				}
+				REQUIRE(fastDisplay.last == accurateDisplay.last);
+			}
+		}
+	}
+}
+
+SCENARIO("The scheduler should run the same frames as the batch loop", "[emulator]") {
+	GIVEN("the boot ROM") {
+		WHEN("running 120 frames, then 100000 cycles, then switching back for 60 frames") {
+			THEN("every frame and the cycle count are identical") {
+				FrameDisplay batchDisplay;
+				FrameDisplay scheduledDisplay;
+				Emulator batch{bootableRom(), batchDisplay, CPU::Engine::Threaded};
+				Emulator scheduled{bootableRom(), scheduledDisplay, CPU::Engine::Threaded};
+				scheduled.setScheduled(true);
+
+				for (int frame = 0; frame < 120; frame++) {
+					auto batchSummary = batch.runFrame();
+					auto scheduledSummary = scheduled.runFrame();
+
+					INFO("frame " << frame);
+					REQUIRE(batchSummary.cycles == scheduledSummary.cycles);
+					REQUIRE(scheduledSummary.frames == 1);
+					REQUIRE(batchDisplay.last == scheduledDisplay.last);
+				}
+
+				auto batchSummary = batch.runFor(100000);
+				auto scheduledSummary = scheduled.runFor(100000);
+				REQUIRE(batchSummary.cycles == scheduledSummary.cycles);
+				REQUIRE(batchSummary.frames == scheduledSummary.frames);
+
+				scheduled.setScheduled(false);
+				for (int frame = 0; frame < 60; frame++) {
+					INFO("frame " << frame);
+					REQUIRE(batch.runFrame().cycles == scheduled.runFrame().cycles);
+					REQUIRE(batchDisplay.last == scheduledDisplay.last);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Code should be cached by ROM bank and address", "[emulator]") {
+	GIVEN("a cartridge that calls 0x4000 in bank 2 and in bank 1 in a loop, counting in 0xc002") {
+		std::vector<BYTE> rom(0x10000, 0);
+		const std::array<BYTE, 30> main{{
+			0x3e, 0x02,		// 0x0150: LD A, 2
+			0xea, 0x00, 0x20,	// LD (0x2000), A
+			0xcd, 0x00, 0x40,	// CALL 0x4000
+			0xea, 0x00, 0xc0,	// LD (0xc000), A
+			0x3e, 0x01,		// LD A, 1
+			0xea, 0x00, 0x20,	// LD (0x2000), A
+			0xcd, 0x00, 0x40,	// CALL 0x4000
+			0xea, 0x01, 0xc0,	// LD (0xc001), A
+			0x21, 0x02, 0xc0,	// LD HL, 0xc002
+			0x34,			// INC (HL)
+			0x18, 0xe4,		// JR 0x0150
+		}};
+		std::copy(main.begin(), main.end(), rom.begin() + 0x150);
+		// 0x0100: JP 0x0150
+		rom[0x100] = 0xc3;
+		rom[0x101] = 0x50;
+		rom[0x102] = 0x01;
+		// LD A, 0x11; RET and LD A, 0x22; RET
+		const std::array<BYTE, 3> bank1{{ 0x3e, 0x11, 0xc9 }};
+		const std::array<BYTE, 3> bank2{{ 0x3e, 0x22, 0xc9 }};
+		std::copy(bank1.begin(), bank1.end(), rom.begin() + 0x4000);
+		std::copy(bank2.begin(), bank2.end(), rom.begin() + 0x8000);
+		makeBootable(rom);
+
+		WHEN("running past the boot ROM and then for 10 more frames on every engine") {
+			THEN("each call ran its bank's code") {
+				for (auto engine : { CPU::Engine::Switch, CPU::Engine::Threaded, CPU::Engine::Cached, CPU::Engine::Jit }) {
+					FrameDisplay display;
+					Emulator emulator{std::unique_ptr<Mapper>{new BankedRom{std::vector<BYTE>(rom)}}, display, engine};
+					for (int frame = 0; frame < 410; frame++) {
+						emulator.runFrame();
+					}
+
+					INFO("engine " << static_cast<int>(engine));
+					REQUIRE(emulator.mmu().readByte(0xc002) != 0);
+					REQUIRE(emulator.mmu().readByte(0xc000) == 0x22);
+					REQUIRE(emulator.mmu().readByte(0xc001) == 0x11);
+				}
+			}
+		}
+		WHEN("setting a breakpoint at 0x4000 in bank 2") {
+			FrameDisplay display;
+			Emulator emulator{std::unique_ptr<Mapper>{new BankedRom{std::vector<BYTE>(rom)}}, display};
+			for (int frame = 0; frame < 400; frame++) {
+				emulator.runFrame();
+			}
+			BankDebugger debugger;
+			emulator.cpu().setBankBreakpoint(2, 0x4000);
+			emulator.cpu().setDebugger(&debugger);
+			BYTE before = emulator.mmu().readByte(0xc002);
+			// about 20 loops
+			emulator.runFor(2000);
+			BYTE loops = static_cast<BYTE>(emulator.mmu().readByte(0xc002) - before);
+
+			THEN("the debugger stops once per loop, not in bank 1") {
+				REQUIRE(loops > 1);
+				REQUIRE(std::abs(debugger.stops - loops) <= 1);
+			}
+		}
+	}
+}
+
+SCENARIO("Performance counters should count the same events on every engine", "[emulator]") {
+	GIVEN("a cartridge that does one DMA and then halts until every VBlank") {
+		WHEN("running past the boot ROM, then for 60 more frames") {
+			THEN("the counters add up, or stay 0 in builds without them") {
+				Counters reference;
+				for (auto engine : { CPU::Engine::Table, CPU::Engine::Switch, CPU::Engine::Threaded, CPU::Engine::Cached, CPU::Engine::Jit }) {
+					FrameDisplay display;
+					Emulator emulator{bootableRom(vblankCountingRom()), display, engine};
+					uint64_t cycles = 0;
+					for (int frame = 0; frame < 400; frame++) {
+						cycles += emulator.runFrame().cycles;
+					}
+					Counters before = emulator.counters();
+					for (int frame = 0; frame < 60; frame++) {
+						cycles += emulator.runFrame().cycles;
+					}
+					Counters after = emulator.counters();
+
+					INFO("engine " << static_cast<int>(engine));
+					if (!Counters::enabled) {
+						REQUIRE(after.instructions == 0);
+						REQUIRE(after.cycles == 0);
+						REQUIRE(after.reads[Counters::ROM] == 0);
+						REQUIRE(after.frames == 0);
+						continue;
+					}
+					REQUIRE(after.cycles == cycles);
+					REQUIRE(after.frames == 460);
+					REQUIRE(after.frames - before.frames == 60);
+					// OAM search, pixel transfer and HBlank for every line, then VBlank
+					REQUIRE(after.modeChanges - before.modeChanges == 60 * (144 * 3 + 1));
+					REQUIRE(after.interrupts - before.interrupts == 60);
+					// LD HL, INC (HL) and RETI, then HALT and JR
+					REQUIRE(after.instructions - before.instructions == 60 * 5);
+					REQUIRE(after.writes[Counters::WRAM] - before.writes[Counters::WRAM] == 60);
+					REQUIRE(after.dmaTransfers == 1);
+					REQUIRE(after.writes[Counters::OAM] == 0xa0);
+					// the boot ROM's logo and its polling of LY
+					REQUIRE(after.writes[Counters::VRAM] > 0);
+					REQUIRE(after.reads[Counters::IO] > 0);
+
+					if (engine == CPU::Engine::Table) {
+						reference = after;
+					}
+					REQUIRE(after.instructions == reference.instructions);
+					REQUIRE(after.writes == reference.writes);
+					// the cached engines fetch a block's instructions once, when decoding it
+					if (engine == CPU::Engine::Table || engine == CPU::Engine::Switch || engine == CPU::Engine::Threaded) {
+						REQUIRE(after.reads == reference.reads);
+					} else {
+						REQUIRE(after.reads[Counters::ROM] < reference.reads[Counters::ROM]);
+					}
+					REQUIRE(after.interrupts == reference.interrupts);
+				}
+			}
+		}
+		WHEN("skipping the boot ROM's idle loops on the switch and the threaded engine") {
+			THEN("both fetch and access memory the same number of times") {
+				FrameDisplay switchDisplay;
+				FrameDisplay threadedDisplay;
+				Emulator sw{bootableRom(vblankCountingRom()), switchDisplay, CPU::Engine::Switch};
+				Emulator threaded{bootableRom(vblankCountingRom()), threadedDisplay, CPU::Engine::Threaded};
+				sw.cpu().setIdleSkipping(true);
+				threaded.cpu().setIdleSkipping(true);
+				for (int frame = 0; frame < 400; frame++) {
+					sw.runFrame();
+					threaded.runFrame();
+				}
+
+				REQUIRE(sw.cpu().skippedCycles() > 0);
+				REQUIRE(sw.cpu().skippedCycles() == threaded.cpu().skippedCycles());
+				REQUIRE(sw.counters().instructions == threaded.counters().instructions);
+				REQUIRE(sw.counters().reads == threaded.counters().reads);
+				REQUIRE(sw.counters().writes == threaded.counters().writes);
+			}
+		}
+	}
+}
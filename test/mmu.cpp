@@ -3,6 +3,8 @@
 #include "catch.hpp"
 #include "immu.h"
 
+// test/cpu.cpp has its own TestMMU
+namespace {
 class TestMMU : public IMMU {
 	public:
 		TestMMU(std::array<BYTE, 1024>& data_) : data{data_} {}
@@ -14,6 +16,7 @@ class TestMMU : public IMMU {
 		}
 		std::array<BYTE, 1024>& data;
 };
+}
 
 SCENARIO("reading a WORD (from bios) should have correct endianness", "[mmu]") {
 	GIVEN("a MMU containing an emptry RomOnly") {
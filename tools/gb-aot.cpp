@@ -0,0 +1,29 @@
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+#include "aot.h"
+#include "codemap.h"
+#include "mapper.h"
+
+int main(int argc, char* argv[]) {
+	// gb-aot <rom> <output>: translate the code reachable from the entry points into C++, to be
+	// linked into gb with make AOT=<output> and run with gb <rom> --aot
+	if (argc != 3) {
+		std::cerr << "usage: gb-aot <rom> <output>\n";
+		return 2;
+	}
+	try {
+		auto rom = Mapper::fromFile(argv[1]);
+		CodeMap map = CodeMap::discover(*rom);
+		std::ofstream out{argv[2]};
+		writeAot(out, *rom, map, argv[1]);
+		if (!out) {
+			std::cerr << "Can't write " << argv[2] << '\n';
+			return 2;
+		}
+	} catch (std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return 2;
+	}
+}
@@ -0,0 +1,27 @@
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+#include "codemap.h"
+#include "mapper.h"
+
+int main(int argc, char* argv[]) {
+	// gb-disasm <rom> [<code map>]: print the code reachable from the entry points, and write the
+	// code map for gb --code-map
+	if (argc != 2 && argc != 3) {
+		std::cerr << "usage: gb-disasm <rom> [<code map>]\n";
+		return 2;
+	}
+	try {
+		auto rom = Mapper::fromFile(argv[1]);
+		CodeMap map = CodeMap::discover(*rom);
+		map.writeDisassembly(std::cout, *rom);
+		if (argc == 3) {
+			std::ofstream out{argv[2], std::ios::binary};
+			map.write(out);
+		}
+	} catch (std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return 2;
+	}
+}
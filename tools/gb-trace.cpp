@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+// lines of context shown before the first difference
+static const std::size_t CONTEXT = 8;
+
+static std::vector<TraceEntry> load(const char* path) {
+	std::ifstream in{path, std::ios::binary};
+	if (!in) {
+		throw std::runtime_error{std::string{"Can't open "} + path};
+	}
+	return Trace::read(in);
+}
+
+static bool same(const TraceEntry& a, const TraceEntry& b) {
+	return a.pc == b.pc && a.opcode == b.opcode && a.operands[0] == b.operands[0] && a.operands[1] == b.operands[1]
+		&& a.af == b.af && a.bc == b.bc && a.de == b.de && a.hl == b.hl && a.sp == b.sp;
+}
+
+// prints the trace, or its last entries
+static int print(const std::vector<TraceEntry>& trace, std::size_t last) {
+	std::size_t start = trace.size() > last ? trace.size() - last : 0;
+	for (std::size_t i = start; i < trace.size(); i++) {
+		std::cout << Trace::format(trace[i]) << '\n';
+	}
+	return 0;
+}
+
+// Compares two traces of the same program from the first cycle stamp both hold, e.g. of two
+// engines or two versions, and shows where they part.
+static int diff(const std::vector<TraceEntry>& a, const std::vector<TraceEntry>& b) {
+	if (a.empty() || b.empty()) {
+		std::cout << "empty trace\n";
+		return 1;
+	}
+	uint64_t stamp = std::max(a.front().stamp, b.front().stamp);
+	auto startOf = [stamp](const std::vector<TraceEntry>& trace) {
+		return static_cast<std::size_t>(std::find_if(trace.begin(), trace.end(), [stamp](const TraceEntry& entry) {
+			return entry.stamp >= stamp;
+		}) - trace.begin());
+	};
+	std::size_t i = startOf(a);
+	std::size_t j = startOf(b);
+	std::size_t matched = 0;
+	for (; i < a.size() && j < b.size(); i++, j++, matched++) {
+		if (!same(a[i], b[j]) || a[i].stamp != b[j].stamp) {
+			for (std::size_t k = std::min(matched, CONTEXT); k > 0; k--) {
+				std::cout << "  " << Trace::format(a[i - k]) << '\n';
+			}
+			std::cout << "< " << Trace::format(a[i]) << '\n';
+			std::cout << "> " << Trace::format(b[j]) << '\n';
+			return 1;
+		}
+	}
+	std::cout << matched << " instructions match";
+	if (i < a.size() || j < b.size()) {
+		std::cout << ", then " << (i < a.size() ? "the first" : "the second") << " trace goes on";
+	}
+	std::cout << '\n';
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	// gb-trace <trace> [<last entries>]: print a trace written by gb --trace
+	// gb-trace --diff <trace> <trace>: show the first difference (exit status 1 if there is one)
+	try {
+		if (argc == 4 && std::string{argv[1]} == "--diff") {
+			return diff(load(argv[2]), load(argv[3]));
+		}
+		if (argc == 2 || argc == 3) {
+			return print(load(argv[1]), argc == 3 ? std::strtoul(argv[2], nullptr, 10) : SIZE_MAX);
+		}
+		std::cerr << "usage: gb-trace <trace> [<last entries>]\n       gb-trace --diff <trace> <trace>\n";
+		return 2;
+	} catch (std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return 2;
+	}
+}